@@ -16,12 +16,47 @@ SOURCES += main.cpp\
         detectgrid.cpp \
         numberrecognition.cpp \
         trainingprogram.cpp \
+        digitclassifier.cpp \
+        digitmodel.cpp \
+        knnkernel.cpp \
+        digitdataset.cpp \
+        digitfeatures.cpp \
+        benchmark.cpp \
+        digitnet.cpp \
+        threadpool.cpp \
+        recognitioncache.cpp \
+        classifierhandle.cpp \
+        digitaugment.cpp \
+        evaluation.cpp \
+        parametersweep.cpp \
+        lshindex.cpp \
+        correctionwriter.cpp \
+        digitpack.cpp \
+        mappedfile.cpp \
         mainwindow.cpp
 
 HEADERS  += mainwindow.h \
         detectgrid.h \
         numberrecognition.h \
-        trainingprogram.h
+        trainingprogram.h \
+        digitclassifier.h \
+        digitmodel.h \
+        knnkernel.h \
+        digitdataset.h \
+        digitfeatures.h \
+        benchmark.h \
+        digitnet.h \
+        threadpool.h \
+        recognitioncache.h \
+        classifierhandle.h \
+        digitaugment.h \
+        evaluation.h \
+        parametersweep.h \
+        lshindex.h \
+        correctionwriter.h \
+        digitpack.h \
+        griddigits.h \
+        mappedfile.h
 
 FORMS    += mainwindow.ui
 
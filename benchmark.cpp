@@ -0,0 +1,572 @@
+#include "benchmark.h"
+#include "detectgrid.h"
+#include "numberrecognition.h"
+#include "digitclassifier.h"
+#include "digitmodel.h"
+#include "knnkernel.h"
+#include "digitdataset.h"
+#include "trainingprogram.h"
+#include "threadpool.h"
+#include "digitaugment.h"
+#include "lshindex.h"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/ml.hpp"
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+//Function with the per-cell cost of the old recognition path: parse both xml files and train a KNearest
+static Ptr<ml::KNearest> loadXmlKNearest()
+{
+    Mat matClassificationInts;
+    Mat matTrainingImagesAsFlattenedFloats;
+
+    FileStorage fsClassifications(CLASSIFICATIONS_FILE, FileStorage::READ);
+    fsClassifications["classifications"] >> matClassificationInts;
+    fsClassifications.release();
+
+    FileStorage fsTrainingImages(TRAINING_IMAGES_FILE, FileStorage::READ);
+    fsTrainingImages["images"] >> matTrainingImagesAsFlattenedFloats;
+    fsTrainingImages.release();
+
+    Ptr<ml::KNearest> kNearest(ml::KNearest::create());
+    if (!matClassificationInts.empty() && !matTrainingImagesAsFlattenedFloats.empty()) {
+        kNearest->train(matTrainingImagesAsFlattenedFloats, ml::ROW_SAMPLE, matClassificationInts);
+    }
+    return kNearest;
+}
+
+//Function to time the recognition of all 81 cells per frame, once with the model
+//reloaded and retrained for every cell (the old behaviour) and once with the cached model
+void benchmarkRecognition(const std::string& imageFile, int frames)
+{
+    Mat src = imread(imageFile, IMREAD_GRAYSCALE);
+    if (!src.data) {
+        cout << "error: image not read from file\n\n";
+        return;
+    }
+
+    TickMeter xmlTimer;
+    xmlTimer.start();
+    loadXmlKNearest();
+    xmlTimer.stop();
+
+    DigitClassifier classifier;
+    TickMeter loadTimer;
+    loadTimer.start();
+    bool loaded = classifier.load(DIGIT_MODEL_FILE);
+    loadTimer.stop();
+    if (!loaded) {
+        return;
+    }
+
+    TickMeter reloadTimer;
+    TickMeter cachedTimer;
+    TickMeter batchTimer;
+    TickMeter skipTimer;
+    TickMeter cacheTimer;
+    TickMeter componentTimer;
+    RecognitionCache cache;
+    int cellsSkipped = 0;
+    int cellsDiffering = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        Mat splitSudoku[9][9];
+        DetectGrid grid;
+
+        grid.splitGrid(src, splitSudoku);
+        reloadTimer.start();
+        for (int y = 0; y < 9; y++)
+        {
+            for (int x = 0; x < 9; x++)
+            {
+                loadXmlKNearest();
+                numberRecognition(splitSudoku[x][y], classifier);
+            }
+        }
+        reloadTimer.stop();
+
+        grid.splitGrid(src, splitSudoku);
+        cachedTimer.start();
+        for (int y = 0; y < 9; y++)
+        {
+            for (int x = 0; x < 9; x++)
+            {
+                numberRecognition(splitSudoku[x][y], classifier);
+            }
+        }
+        cachedTimer.stop();
+
+        int numberArray[9][9];
+        grid.splitGrid(src, splitSudoku);
+        batchTimer.start();
+        recognizeGrid(splitSudoku, numberArray, classifier);
+        batchTimer.stop();
+
+        bool emptyCells[9][9];
+        RecognitionStats stats;
+        grid.splitGrid(src, splitSudoku, emptyCells);
+        skipTimer.start();
+        recognizeGrid(splitSudoku, numberArray, classifier, emptyCells, &stats);
+        skipTimer.stop();
+        cellsSkipped += stats.cellsSkipped;
+
+        //the same scan again and again, from the second frame on every digit is a cache hit
+        grid.splitGrid(src, splitSudoku, emptyCells);
+        cacheTimer.start();
+        recognizeGrid(splitSudoku, numberArray, classifier, emptyCells, nullptr, nullptr, nullptr, &cache);
+        cacheTimer.stop();
+
+        //one component pass over the grid instead of a threshold and findContours per cell, the labelling is timed too
+        GridDigits digits;
+        int componentArray[9][9];
+        Mat cells;
+        bitwise_not(grid.removeGridLines(grid.findGrid(src)), cells);
+        componentTimer.start();
+        grid.findDigitComponents(cells, digits);
+        recognizeGridDigits(digits, componentArray, classifier);
+        componentTimer.stop();
+        for (int y = 0; y < 9; y++) {
+            for (int x = 0; x < 9; x++) {
+                if (componentArray[x][y] != numberArray[x][y]) cellsDiffering++;
+            }
+        }
+    }
+
+    cout << "cold start, xml parse + train:  " << xmlTimer.getTimeMilli() << " ms" << endl;
+    cout << "cold start, map binary model:   " << loadTimer.getTimeMilli() << " ms" << endl;
+    cout << "per frame, reload per cell:     " << reloadTimer.getTimeMilli() / frames << " ms" << endl;
+    cout << "per frame, cached model:        " << cachedTimer.getTimeMilli() / frames << " ms" << endl;
+    cout << "per frame, one batched search:  " << batchTimer.getTimeMilli() / frames << " ms" << endl;
+    cout << "per frame, empty cells skipped: " << skipTimer.getTimeMilli() / frames << " ms ("
+         << double(cellsSkipped) / frames << " of 81 cells skipped)" << endl;
+    cout << "per frame, result cache:        " << cacheTimer.getTimeMilli() / frames << " ms ("
+         << 100.0 * cache.hitRate() << " % hits, " << cache.memoryUsage() << " bytes)" << endl;
+    cout << "per frame, one component pass:  " << componentTimer.getTimeMilli() / frames << " ms ("
+         << double(cellsDiffering) / frames << " of 81 cells read differently)" << endl;
+}
+
+//Function to time the recognition of one grid with 1 to 16 threads, the pool is started outside the timing
+//like the main window does once. Every thread count has to give the grid of the single thread run.
+void benchmarkThreadScaling(const std::string& imageFile, int frames)
+{
+    Mat src = imread(imageFile, IMREAD_GRAYSCALE);
+    if (!src.data) {
+        cout << "error: image not read from file\n\n";
+        return;
+    }
+    DigitClassifier classifier;
+    if (!classifier.load(DIGIT_MODEL_FILE)) {
+        return;
+    }
+
+    Mat splitSudoku[9][9];
+    bool emptyCells[9][9];
+    DetectGrid grid;
+    grid.splitGrid(src, splitSudoku, emptyCells);
+
+    int expected[9][9];
+    recognizeGrid(splitSudoku, expected, classifier, emptyCells);
+
+    double singleThreadMs = 0;
+    const int threadCounts[] = {1, 2, 4, 8, 16};
+    for (int threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        int numberArray[9][9];
+        bool identical = true;
+        TickMeter timer;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            timer.start();
+            recognizeGrid(splitSudoku, numberArray, classifier, emptyCells, nullptr, nullptr, &pool);
+            timer.stop();
+            for (int i = 0; i < 81; i++) {
+                if (numberArray[i % 9][i / 9] != expected[i % 9][i / 9]) identical = false;
+            }
+        }
+        double frameMs = timer.getTimeMilli() / frames;
+        if (threads == 1) singleThreadMs = frameMs;
+        cout << threads << " threads: " << frameMs << " ms per frame, speedup " << singleThreadMs / frameMs
+             << (identical ? "" : ", RESULT DIFFERS FROM ONE THREAD") << endl;
+    }
+}
+
+//Function to make rows that look like thresholded 20x30 ROIs, every pixel is either 0 or 255
+static Mat randomThresholdedSamples(RNG& rng, int rows)
+{
+    Mat pixels(rows, RESIZED_IMAGE_WIDTH * RESIZED_IMAGE_HEIGHT, CV_8U);
+    Mat samples;
+    rng.fill(pixels, RNG::UNIFORM, 0, 2);
+    pixels.convertTo(samples, CV_32F, 255);
+    return samples;
+}
+
+//Function to compare cv::ml::KNearest with the hand written kernels on random 20x30 training sets of growing size
+void benchmarkNearestNeighbours()
+{
+    const int sampleSizes[] = {1000, 10000, 100000};
+    const int queryCount = 81;
+    const int k = 5;
+    const int sampleLength = RESIZED_IMAGE_WIDTH * RESIZED_IMAGE_HEIGHT;
+    const KnnKernel kernels[] = {KNN_KERNEL_SCALAR, KNN_KERNEL_SSE2, KNN_KERNEL_AVX2};
+    RNG rng(12345);
+
+    Mat queries = randomThresholdedSamples(rng, queryCount);
+
+    for (int sampleCount : sampleSizes)
+    {
+        Mat samples = randomThresholdedSamples(rng, sampleCount);
+        Mat labels(sampleCount, 1, CV_32S);
+        rng.fill(labels, RNG::UNIFORM, '1', '9' + 1);
+
+        Ptr<ml::KNearest> kNearest(ml::KNearest::create());
+        kNearest->train(samples, ml::ROW_SAMPLE, labels);
+        Mat results;
+        TickMeter openCvTimer;
+        openCvTimer.start();
+        kNearest->findNearest(queries, k, results);
+        openCvTimer.stop();
+        cout << sampleCount << " samples, cv::ml::KNearest: " << openCvTimer.getTimeMilli() / queryCount << " ms per query" << endl;
+
+        Mat nearest(queryCount, k, CV_32S);
+        Mat distances(queryCount, k, CV_32F);
+        for (KnnKernel kernel : kernels)
+        {
+            if (!knnKernelSupported(kernel)) continue;
+            TickMeter kernelTimer;
+            kernelTimer.start();
+            nearestNeighbours(queries.ptr<float>(), queryCount, samples.ptr<float>(), sampleCount, sampleLength,
+                              k, nearest.ptr<int>(), distances.ptr<float>(), kernel);
+            kernelTimer.stop();
+            cout << sampleCount << " samples, " << knnKernelName(kernel) << " kernel: " << kernelTimer.getTimeMilli() / queryCount << " ms per query" << endl;
+        }
+    }
+}
+
+//Function to measure accuracy, speed and memory of every classifier mode on a train/test split of a labelled digit tree
+void compareClassifierModes(const std::string& dataBaseDirectory)
+{
+    Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return;
+    }
+    Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+    cout << trainSamples.rows << " training samples, " << testSamples.rows << " test samples" << endl;
+
+    const ClassifierMode modes[] = {CLASSIFIER_FLOAT, CLASSIFIER_BINARY};
+    const char* const modeNames[] = {"float knn", "binary knn"};
+    for (int m = 0; m < 2; m++)
+    {
+        DigitModelContents contents;
+        contents.labels = trainLabels;
+        contents.samples = trainSamples;
+        DigitClassifier classifier;
+        classifier.create(contents, modes[m]);
+
+        vector<int> intChars;
+        TickMeter timer;
+        timer.start();
+        classifier.classifyBatch(testSamples, intChars);
+        timer.stop();
+
+        cout << modeNames[m] << ": accuracy " << labelAccuracy(intChars, testLabels) << " %, "
+             << timer.getTimeMicro() / testSamples.rows << " us per sample, "
+             << classifier.memoryUsage() << " bytes of model" << endl;
+    }
+}
+
+//Function to measure accuracy and throughput of the float classifier for a range of PCA dimensions
+void benchmarkPcaDimensions(const std::string& dataBaseDirectory)
+{
+    Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return;
+    }
+    Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+
+    const int dimensions[] = {0, 16, 32, 48, 64, 96};       // 0 is the unprojected 600 pixels
+    for (int components : dimensions)
+    {
+        DigitModelContents contents;
+        contents.labels = trainLabels;
+        contents.samples = trainSamples;
+        if (components > 0) {
+            fitProjection(trainSamples, components, contents.projectionMean, contents.projectionVectors, contents.samples);
+        }
+        DigitClassifier classifier;
+        classifier.create(contents);
+
+        vector<int> intChars;
+        TickMeter timer;
+        timer.start();
+        classifier.classifyBatch(testSamples, intChars);
+        timer.stop();
+
+        cout << (components == 0 ? trainSamples.cols : components) << " dimensions: accuracy "
+             << labelAccuracy(intChars, testLabels) << " %, "
+             << testSamples.rows / timer.getTimeSec() << " samples per second" << endl;
+    }
+}
+
+//Function to measure extraction time, classification time and accuracy of every feature extractor
+void compareFeatureExtractors(const std::string& dataBaseDirectory)
+{
+    Mat labels;
+    vector<Mat> images;
+    if (!loadDigitImages(dataBaseDirectory, labels, images)) {
+        return;
+    }
+
+    for (int type = 0; type < FEATURE_TYPE_COUNT; type++)
+    {
+        FeatureType featureType = FeatureType(type);
+        TickMeter extractTimer;
+        extractTimer.start();
+        Mat samples = digitImagesToSamples(images, featureType);
+        extractTimer.stop();
+
+        DigitModelContents contents;
+        Mat testLabels, testSamples;
+        splitTrainTest(labels, samples, 4, contents.labels, contents.samples, testLabels, testSamples);
+        contents.featureType = featureType;
+        DigitClassifier classifier;
+        classifier.create(contents);
+
+        vector<int> intChars;
+        TickMeter timer;
+        timer.start();
+        classifier.classifyBatch(testSamples, intChars);
+        timer.stop();
+
+        cout << featureTypeName(featureType) << " (" << featureLength(featureType) << " values): accuracy "
+             << labelAccuracy(intChars, testLabels) << " %, "
+             << extractTimer.getTimeMicro() / samples.rows << " us extraction and "
+             << timer.getTimeMicro() / testSamples.rows << " us classification per sample" << endl;
+    }
+}
+
+//Function to train with and without augmented copies and test on the clean test images and on distorted copies
+//of them (another seed), the distorted ones stand in for blurred and tilted webcam digits
+void compareAugmentation(const std::string& dataBaseDirectory, int variants)
+{
+    ThreadPool pool;
+    Mat labels;
+    vector<Mat> images;
+    if (!loadDigitImages(dataBaseDirectory, labels, images, &pool)) {
+        return;
+    }
+
+    vector<Mat> trainImages, testImages;
+    Mat trainLabels, testLabels;
+    for (size_t i = 0; i < images.size(); i++) {
+        bool test = i % 4 == 3;         // the split of splitTrainTest
+        (test ? testImages : trainImages).push_back(images[i]);
+        (test ? testLabels : trainLabels).push_back(labels.row(int(i)));
+    }
+
+    //augmentedSamples puts each original before its distorted copy, keep only the copies
+    AugmentOptions distort;
+    distort.variants = 1;
+    distort.seed = 12345;
+    Mat augmentedLabels, distortedLabels, distortedSamples;
+    Mat augmented = augmentedSamples(testImages, testLabels, FEATURE_PIXELS, distort, augmentedLabels, &pool);
+    for (int row = 1; row < augmented.rows; row += 1 + distort.variants) {
+        distortedSamples.push_back(augmented.row(row));
+        distortedLabels.push_back(augmentedLabels.row(row));
+    }
+    Mat cleanSamples = digitImagesToSamples(testImages, FEATURE_PIXELS, &pool);
+
+    const int variantCounts[] = {0, variants};
+    for (int v : variantCounts)
+    {
+        AugmentOptions augment;
+        augment.variants = v;
+        TickMeter augmentTimer;
+        augmentTimer.start();
+        DigitModelContents contents;
+        contents.samples = augmentedSamples(trainImages, trainLabels, FEATURE_PIXELS, augment, contents.labels, &pool);
+        augmentTimer.stop();
+        DigitClassifier classifier;
+        classifier.create(contents);
+
+        vector<int> cleanChars, distortedChars;
+        classifier.classifyBatch(cleanSamples, cleanChars);
+        classifier.classifyBatch(distortedSamples, distortedChars);
+        cout << v << " variants: " << contents.samples.rows << " samples in " << augmentTimer.getTimeMilli() << " ms, accuracy "
+             << labelAccuracy(cleanChars, testLabels) << " % clean, "
+             << labelAccuracy(distortedChars, distortedLabels) << " % distorted" << endl;
+    }
+}
+
+//Function to compare the quantised network with the float knn on the test part of a labelled digit tree,
+//one cell at a time like numberRecognition classifies a single grid cell
+void benchmarkDigitNet(const std::string& netFile, const std::string& dataBaseDirectory)
+{
+    Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return;
+    }
+    Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+
+    DigitClassifier knn;
+    DigitModelContents contents;
+    contents.labels = trainLabels;
+    contents.samples = trainSamples;
+    knn.create(contents);
+
+    DigitClassifier net;
+    if (!net.loadNet(netFile)) {
+        return;
+    }
+
+    const DigitClassifier* classifiers[] = {&knn, &net};
+    const char* const names[] = {"float knn", "int8 net"};
+    for (int c = 0; c < 2; c++)
+    {
+        vector<int> intChars(size_t(testSamples.rows));
+        TickMeter timer;
+        timer.start();
+        for (int row = 0; row < testSamples.rows; row++) {
+            intChars[size_t(row)] = classifiers[c]->classify(testSamples.row(row));
+        }
+        timer.stop();
+
+        cout << names[c] << ": accuracy " << labelAccuracy(intChars, testLabels) << " %, "
+             << timer.getTimeMicro() / testSamples.rows << " us per cell, "
+             << classifiers[c]->memoryUsage() << " bytes of model" << endl;
+    }
+}
+
+//Function to compare the binary and float knn with the cascade of both, on all test samples and on the
+//digits that are mixed up most (1/7, 3/8, 5/6), one sample at a time like a grid cell
+void compareCascade(const std::string& dataBaseDirectory)
+{
+    Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return;
+    }
+    Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+
+    DigitModelContents contents;
+    contents.labels = trainLabels;
+    contents.samples = trainSamples;
+    shared_ptr<DigitClassifier> floatKnn = make_shared<DigitClassifier>();
+    DigitClassifier binaryKnn;
+    DigitClassifier cascade;
+    if (!floatKnn->create(contents) || !binaryKnn.create(contents, CLASSIFIER_BINARY)
+            || !cascade.create(contents, CLASSIFIER_BINARY) || !cascade.setSecondStage(floatKnn)) {
+        return;
+    }
+
+    const string hardDigits = "173856";
+    const DigitClassifier* classifiers[] = {&binaryKnn, floatKnn.get(), &cascade};
+    const char* const names[] = {"binary knn", "float knn", "cascade"};
+    for (int c = 0; c < 3; c++)
+    {
+        vector<DigitPrediction> predictions(size_t(testSamples.rows));
+        TickMeter timer;
+        timer.start();
+        for (int row = 0; row < testSamples.rows; row++) {
+            vector<DigitPrediction> rowPrediction;
+            classifiers[c]->classifyBatch(testSamples.row(row), rowPrediction);
+            predictions[size_t(row)] = rowPrediction[0];
+        }
+        timer.stop();
+
+        int correct = 0, hard = 0, hardCorrect = 0, secondStage = 0;
+        for (int row = 0; row < testSamples.rows; row++) {
+            int label = testLabels.at<int>(row);
+            bool right = predictions[size_t(row)].labels[0] == label;
+            correct += right;
+            if (hardDigits.find(char(label)) != string::npos) {
+                hard++;
+                hardCorrect += right;
+            }
+            secondStage += predictions[size_t(row)].stage == 2;
+        }
+        cout << names[c] << ": accuracy " << 100.0 * correct / max(1, testSamples.rows) << " %, on 1/7 3/8 5/6 "
+             << 100.0 * hardCorrect / max(1, hard) << " %, " << timer.getTimeMicro() / testSamples.rows << " us per cell, "
+             << 100.0 * secondStage / max(1, testSamples.rows) << " % of the cells reach the second stage" << endl;
+    }
+}
+
+//Function to measure recall and time per query of the neighbour index for a range of probes on a training
+//set grown with augmented copies, recall is the share of the exact k nearest samples the index finds
+void benchmarkIndex(const std::string& dataBaseDirectory, int variants)
+{
+    ThreadPool pool;
+    Mat labels;
+    vector<Mat> images;
+    if (!loadDigitImages(dataBaseDirectory, labels, images, &pool)) {
+        return;
+    }
+    vector<Mat> trainImages, testImages;
+    Mat trainLabels, testLabels;
+    for (size_t i = 0; i < images.size(); i++) {
+        bool test = i % 4 == 3;         // the split of splitTrainTest
+        (test ? testImages : trainImages).push_back(images[i]);
+        (test ? testLabels : trainLabels).push_back(labels.row(int(i)));
+    }
+    AugmentOptions augment;
+    augment.variants = variants;
+    DigitModelContents contents;
+    contents.samples = augmentedSamples(trainImages, trainLabels, FEATURE_PIXELS, augment, contents.labels, &pool);
+    Mat testSamples = digitImagesToSamples(testImages, FEATURE_PIXELS, &pool);
+
+    TickMeter buildTimer;
+    buildTimer.start();
+    contents.index = LshIndex::build(contents.samples.ptr<float>(), contents.samples.rows, contents.samples.cols,
+                                     LSH_DEFAULT_TABLES, LSH_DEFAULT_BITS, 1, &pool);
+    buildTimer.stop();
+    DigitClassifier classifier;
+    if (!classifier.create(contents)) {
+        return;
+    }
+    cout << contents.samples.rows << " training samples, " << testSamples.rows << " queries, index built in "
+         << buildTimer.getTimeMilli() << " ms, " << contents.index.size() << " bytes" << endl;
+
+    LshIndex index;
+    index.open(contents.index.data(), contents.index.size());
+    int k = DEFAULT_NEIGHBOURS;
+    vector<int> exactIdx(size_t(testSamples.rows) * k);
+    vector<float> exactDist(exactIdx.size());
+    nearestNeighbours(testSamples.ptr<float>(), testSamples.rows, contents.samples.ptr<float>(), contents.samples.rows,
+                      contents.samples.cols, k, exactIdx.data(), exactDist.data());
+
+    const int probeCounts[] = {0, 1, 2, 4, 8, 16};      // 0 is the exact search
+    for (int probes : probeCounts)
+    {
+        vector<int> foundIdx(exactIdx.size());
+        vector<float> foundDist(exactIdx.size());
+        index.search(testSamples.ptr<float>(), testSamples.rows, contents.samples.ptr<float>(), k, probes,
+                     foundIdx.data(), foundDist.data());
+        int recalled = 0;
+        for (int q = 0; q < testSamples.rows; q++) {
+            for (int i = 0; i < k; i++) {
+                const int* exact = exactIdx.data() + size_t(q) * k;
+                recalled += find(exact, exact + k, foundIdx[size_t(q) * k + i]) != exact + k;
+            }
+        }
+
+        //one query at a time through the classifier, like a cell
+        classifier.setIndexProbes(probes);
+        vector<int> intChars(size_t(testSamples.rows));
+        TickMeter timer;
+        timer.start();
+        for (int row = 0; row < testSamples.rows; row++) {
+            intChars[size_t(row)] = classifier.classify(testSamples.row(row));
+        }
+        timer.stop();
+
+        cout << (probes == 0 ? "exact" : to_string(probes) + " probes") << ": recall "
+             << 100.0 * recalled / max(1, testSamples.rows * k) << " %, accuracy " << labelAccuracy(intChars, testLabels)
+             << " %, " << timer.getTimeMicro() / max(1, testSamples.rows) << " us per query" << endl;
+    }
+}
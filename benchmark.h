@@ -0,0 +1,17 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+void benchmarkRecognition(const std::string& imageFile, int frames);
+void benchmarkNearestNeighbours();
+void benchmarkThreadScaling(const std::string& imageFile, int frames);
+void compareClassifierModes(const std::string& dataBaseDirectory);
+void benchmarkPcaDimensions(const std::string& dataBaseDirectory);
+void compareFeatureExtractors(const std::string& dataBaseDirectory);
+void compareAugmentation(const std::string& dataBaseDirectory, int variants);
+void benchmarkDigitNet(const std::string& netFile, const std::string& dataBaseDirectory);
+void compareCascade(const std::string& dataBaseDirectory);
+void benchmarkIndex(const std::string& dataBaseDirectory, int variants);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,53 @@
+#include "classifierhandle.h"
+#include <fstream>
+
+//Function to load the classifier the program should use: a quantised network if netFile exists,
+//otherwise the digit model. With convertXml a missing model is first converted from the xml training files,
+//only the first start does that: a model that exists but does not load is never overwritten.
+//A model of unprojected pixels without a neighbour index is read through a cascade, the bit templates answer the cells they
+//are sure about and the float samples only see the hard ones. Both stages read the one mapping of the float stage,
+//a second open of the file could see a segment appended in between and number the samples differently.
+//Returns an empty pointer if nothing could be loaded.
+std::shared_ptr<DigitClassifier> loadClassifier(const std::string& modelFile, const std::string& netFile, bool convertXml)
+{
+    std::shared_ptr<DigitClassifier> classifier = std::make_shared<DigitClassifier>();
+    if (!netFile.empty() && std::ifstream(netFile).good() && classifier->loadNet(netFile)) {
+        return classifier;
+    }
+    if (convertXml && !std::ifstream(modelFile).good()) {
+        //no binary model yet, convert the xml training files written by older training programs
+        convertXmlModel(CLASSIFICATIONS_FILE, TRAINING_IMAGES_FILE, modelFile);
+    }
+    if (!classifier->load(modelFile)) {
+        return std::shared_ptr<DigitClassifier>();
+    }
+    if (classifier->featureType() != FEATURE_PIXELS || classifier->isProjected() || classifier->hasIndex()) {
+        return classifier;          // an indexed float search is already faster than the bits over every sample
+    }
+    std::shared_ptr<DigitClassifier> firstStage = std::make_shared<DigitClassifier>();
+    if (firstStage->load(classifier->mappedModel(), CLASSIFIER_BINARY) && firstStage->setSecondStage(classifier)) {
+        return firstStage;
+    }
+    return classifier;
+}
+
+std::shared_ptr<const DigitClassifier> ClassifierHandle::acquire() const
+{
+    return std::atomic_load(&current);
+}
+
+void ClassifierHandle::publish(std::shared_ptr<const DigitClassifier> classifier)
+{
+    std::atomic_store(&current, std::move(classifier));
+}
+
+//Function to load the model files at startup, the xml training files are converted if there is no model yet
+bool ClassifierHandle::load(const std::string& modelFile, const std::string& netFile)
+{
+    std::shared_ptr<DigitClassifier> classifier = loadClassifier(modelFile, netFile, true);
+    if (!classifier) {
+        return false;
+    }
+    publish(classifier);
+    return true;
+}
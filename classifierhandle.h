@@ -0,0 +1,25 @@
+#ifndef CLASSIFIERHANDLE_H
+#define CLASSIFIERHANDLE_H
+
+#include "digitclassifier.h"
+#include <memory>
+#include <string>
+
+std::shared_ptr<DigitClassifier> loadClassifier(const std::string& modelFile, const std::string& netFile, bool convertXml = false);
+
+// Read-copy-update handle to the classifier in use. A frame takes a snapshot with
+// acquire() and recognises with it to the end; a reload builds a new classifier
+// next to the old one and publish() swaps the pointer in one atomic store. The old
+// model is unmapped when the last frame that still holds it lets go. Reloads while
+// the GUI runs go through its CorrectionWriter, so they never meet an append.
+class ClassifierHandle
+{
+private:
+    std::shared_ptr<const DigitClassifier> current;     // only read and written with the atomic shared_ptr functions
+public:
+    std::shared_ptr<const DigitClassifier> acquire() const;
+    void publish(std::shared_ptr<const DigitClassifier> classifier);
+    bool load(const std::string& modelFile, const std::string& netFile);
+};
+
+#endif // CLASSIFIERHANDLE_H
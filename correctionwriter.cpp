@@ -0,0 +1,180 @@
+#include "correctionwriter.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+//Function to read the header of a model file, whatever is in it
+static bool readModelHeader(const std::string& modelFile, DigitModelHeader& header)
+{
+    std::ifstream in(modelFile, std::ios::binary);
+    return bool(in.read(reinterpret_cast<char*>(&header), sizeof(header)));
+}
+
+CorrectionWriter::CorrectionWriter(const std::string& file, ClassifierHandle& handle) : modelFile(file), classifier(handle)
+{
+    memset(&ownHeader, 0, sizeof(ownHeader));
+    writer = std::thread(&CorrectionWriter::writerLoop, this);
+}
+
+CorrectionWriter::~CorrectionWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_one();
+    writer.join();
+}
+
+//Function to teach the classifier in use labelled feature rows at once and queue them for the model file.
+//Returns the new classifier, empty if the one in use can not learn corrections. Never waits for the disk.
+std::shared_ptr<const DigitClassifier> CorrectionWriter::learn(const cv::Mat& labels, const cv::Mat& samples)
+{
+    std::shared_ptr<DigitClassifier> corrected;
+    {
+        std::lock_guard<std::mutex> lock(mutex);        // a reload can not publish its classifier in between and lose these rows
+        std::shared_ptr<const DigitClassifier> model = classifier.acquire();
+        if (model) {
+            corrected = model->withCorrections(labels, samples);
+        }
+        if (!corrected) {
+            return corrected;
+        }
+        classifier.publish(corrected);
+        pendingLabels.push_back(labels.reshape(1, int(labels.total())));
+        pendingSamples.push_back(samples);
+    }
+    queued.notify_one();
+    return corrected;
+}
+
+//Function to queue a reload of the model files, done gets the result on the writer thread. Without force
+//the model file is only loaded again if it was not our own append that changed it.
+void CorrectionWriter::reload(const std::string& netFile, bool force, const std::function<void(ModelReload)>& done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back([this, netFile, force, done] {
+            done(!force && isOwnHeader() ? MODEL_UNCHANGED : reloadNow(netFile));
+        });
+    }
+    queued.notify_one();
+}
+
+//Function to queue the conversion of new xml training files into the model file, followed by a reload.
+//The corrections appended so far are appended to the converted model again, so a conversion does not drop them.
+void CorrectionWriter::convertXml(const std::string& classificationsFile, const std::string& imagesFile, const std::string& netFile,
+                                  const std::function<void(ModelReload)>& done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back([this, classificationsFile, imagesFile, netFile, done] {
+            if (!convertXmlModel(classificationsFile, imagesFile, modelFile)) {
+                done(MODEL_RELOAD_FAILED);
+                return;
+            }
+            cv::Mat labels;
+            cv::Mat samples;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                labels = writtenLabels;
+                samples = writtenSamples;
+            }
+            if (!labels.empty() && !appendDigitModel(modelFile, labels, samples)) {
+                //the reload below still adds them to the classifier in use
+                std::cout << "error, " << labels.rows << " corrections could not be added to the converted model\n\n";
+                std::lock_guard<std::mutex> lock(mutex);
+                failedLabels.push_back(labels);
+                failedSamples.push_back(samples);
+                writtenLabels = cv::Mat();
+                writtenSamples = cv::Mat();
+            }
+            done(reloadNow(netFile));
+        });
+    }
+    queued.notify_one();
+}
+
+//Function to tell if the model file still holds what we last wrote or loaded
+bool CorrectionWriter::isOwnHeader() const
+{
+    DigitModelHeader header;
+    return ownHeaderValid && readModelHeader(modelFile, header) && memcmp(&header, &ownHeader, sizeof(header)) == 0;
+}
+
+//Function to load the model files and swap them in with the corrections that are not in the file added.
+//Only runs on the writer thread, so no append is half done.
+ModelReload CorrectionWriter::reloadNow(const std::string& netFile)
+{
+    DigitModelHeader header;
+    bool headerRead = readModelHeader(modelFile, header);       // before the load, a write after it then reloads again
+    std::shared_ptr<DigitClassifier> loaded = loadClassifier(modelFile, netFile);
+    if (!loaded) {
+        std::cout << "error, keeping the current digit model\n\n";
+        return MODEL_RELOAD_FAILED;
+    }
+    ownHeader = header;
+    ownHeaderValid = headerRead;
+
+    std::lock_guard<std::mutex> lock(mutex);            // learn() adds to this classifier or its rows are in pendingLabels
+    std::shared_ptr<const DigitClassifier> model = loaded;
+    cv::Mat labels;
+    cv::Mat samples;
+    const cv::Mat* rowLabels[] = {&failedLabels, &pendingLabels};
+    const cv::Mat* rowSamples[] = {&failedSamples, &pendingSamples};
+    for (int i = 0; i < 2; i++) {
+        if (!rowLabels[i]->empty()) {
+            labels.push_back(*rowLabels[i]);
+            samples.push_back(*rowSamples[i]);
+        }
+    }
+    if (!labels.empty()) {
+        std::shared_ptr<DigitClassifier> corrected = loaded->withCorrections(labels, samples);
+        if (corrected) {
+            model = corrected;
+        }
+    }
+    classifier.publish(model);
+    return MODEL_RELOADED;
+}
+
+void CorrectionWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        queued.wait(lock, [&] { return stopping || !pendingLabels.empty() || !jobs.empty(); });
+        if (!pendingLabels.empty()) {
+            cv::Mat labels = pendingLabels;
+            cv::Mat samples = pendingSamples;
+            pendingLabels = cv::Mat();
+            pendingSamples = cv::Mat();
+            lock.unlock();
+
+            DigitModelHeader header;
+            bool appended = appendDigitModel(modelFile, labels, samples, &header);
+            if (appended) {
+                ownHeader = header;
+                ownHeaderValid = true;
+            }
+            else {
+                //the classifier in use keeps them and a reload adds them again, they are only lost for the next start
+                std::cout << "error, " << labels.rows << " corrections were not written to " << modelFile << "\n\n";
+            }
+            lock.lock();
+            cv::Mat& keptLabels = appended ? writtenLabels : failedLabels;
+            cv::Mat& keptSamples = appended ? writtenSamples : failedSamples;
+            keptLabels.push_back(labels);
+            keptSamples.push_back(samples);
+            continue;
+        }
+        if (stopping) {
+            return;                     // every row is written, the queued reloads are of no use any more
+        }
+        std::function<void()> job = jobs.front();
+        jobs.erase(jobs.begin());
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
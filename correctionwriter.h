@@ -0,0 +1,61 @@
+#ifndef CORRECTIONWRITER_H
+#define CORRECTIONWRITER_H
+
+#include "opencv2/core.hpp"
+#include "classifierhandle.h"
+#include "digitmodel.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum ModelReload {
+    MODEL_UNCHANGED,            // the change was our own append, the classifier in use already has it
+    MODEL_RELOADED,
+    MODEL_RELOAD_FAILED         // the old classifier stays in use
+};
+
+// Background thread for everything that touches the model file while the GUI runs.
+// learn() puts corrected digits into the classifier in use at once and queues them,
+// the thread appends them to the model file with appendDigitModel, everything queued
+// while a write runs goes into the next segment together. Reloads and xml conversions
+// are queued as well and run on the same thread between two appends, so they never
+// see a half written segment and the UI thread never waits for the disk. A reload
+// adds the corrections that are not in the file yet to the classifier it loaded.
+// The destructor writes the rows that are left and drops the queued reloads.
+class CorrectionWriter
+{
+private:
+    std::string modelFile;
+    ClassifierHandle& classifier;
+    std::thread writer;
+    std::mutex mutex;                   // guards the rows and jobs, and swapping the classifier in use
+    std::condition_variable queued;
+    cv::Mat pendingLabels;              // N x 1 CV_32S character codes
+    cv::Mat pendingSamples;             // N x featureLength CV_32F, unprojected
+    cv::Mat failedLabels;               // rows an append could not write, only the classifier in use has them
+    cv::Mat failedSamples;
+    cv::Mat writtenLabels;              // rows in the model file, appended again after an xml conversion
+    cv::Mat writtenSamples;
+    std::vector<std::function<void()> > jobs;
+    bool stopping = false;
+    DigitModelHeader ownHeader;         // writer thread only: the header after our last write or reload
+    bool ownHeaderValid = false;
+    void writerLoop();
+    bool isOwnHeader() const;
+    ModelReload reloadNow(const std::string& netFile);
+public:
+    CorrectionWriter(const std::string& file, ClassifierHandle& handle);
+    ~CorrectionWriter();
+    CorrectionWriter(const CorrectionWriter&) = delete;
+    CorrectionWriter& operator=(const CorrectionWriter&) = delete;
+    std::shared_ptr<const DigitClassifier> learn(const cv::Mat& labels, const cv::Mat& samples);
+    void reload(const std::string& netFile, bool force, const std::function<void(ModelReload)>& done);
+    void convertXml(const std::string& classificationsFile, const std::string& imagesFile, const std::string& netFile,
+                    const std::function<void(ModelReload)>& done);
+};
+
+#endif // CORRECTIONWRITER_H
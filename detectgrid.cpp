@@ -1,4 +1,5 @@
 #include "detectgrid.h"
+#include "numberrecognition.h"
 
 using namespace cv;
 using namespace std;
@@ -6,13 +7,10 @@ using namespace std;
 //Function to find the Sudoku grid and separate it from the full image
 Mat DetectGrid::findGrid(Mat grayScaleSrc)
 {
-    //clone src
-    Mat srcb = grayScaleSrc.clone();
-
-    //smooth the image
+    //smooth the image, the source is only read so it needs no copy
     Mat smooth;
     Mat thresholded;
-    GaussianBlur(srcb, smooth, Size(11, 11), 0, 0); //removing noises
+    GaussianBlur(grayScaleSrc, smooth, Size(11, 11), 0, 0); //removing noises
     adaptiveThreshold(smooth, thresholded, 255, ADAPTIVE_THRESH_MEAN_C,THRESH_BINARY_INV, 15, 5);
 
     //find contours
@@ -86,9 +84,8 @@ Mat DetectGrid::findGrid(Mat grayScaleSrc)
 
     //warp the image
     Mat wrap; Mat mat;
-    mat = Mat::zeros(grayScaleSrc.size(), grayScaleSrc.type());
     wrap = getPerspectiveTransform(warpIn, warpOut);
-    warpPerspective(srcb, mat, wrap, Size(450, 450));
+    warpPerspective(grayScaleSrc, mat, wrap, Size(450, 450));     //single channel 8 bit, like the source
     return mat;
 }
 
@@ -120,22 +117,117 @@ Mat DetectGrid::removeGridLines(Mat grid)
 
 
 
+//Function to mark the cells without a digit, the ink in the centre of every cell is
+//counted with one integral image of the whole grid instead of looking at each cell
+void DetectGrid::findEmptyCells(Mat grid, bool emptyCells[9][9])
+{
+    Mat ink;
+    Mat sums;
+    threshold(grid, ink, 0, 1, THRESH_BINARY);      //ink pixels count as 1
+    integral(ink, sums, CV_32S);
+
+    for (int m = 0; m < 450; m += CELL_SIZE)
+    {
+        for (int n = 0; n < 450; n += CELL_SIZE)
+        {
+            int top = m + CELL_MARGIN;
+            int left = n + CELL_MARGIN;
+            int bottom = m + CELL_SIZE - CELL_MARGIN;
+            int right = n + CELL_SIZE - CELL_MARGIN;
+            int inkPixels = sums.at<int>(bottom, right) - sums.at<int>(top, right)
+                          - sums.at<int>(bottom, left) + sums.at<int>(top, left);
+            emptyCells[n/CELL_SIZE][m/CELL_SIZE] = inkPixels < MIN_INK_PIXELS;
+        }
+    }
+}
+
+//Function to find the digits of all cells with one connected component labelling of the grid instead of
+//a threshold and findContours per cell. The grid gets the blur and threshold extractDigitSamples gives every
+//cell, once for the whole grid, so the digit ROIs hold the same pixels. A component belongs to the cell its
+//centroid falls in and is clipped to that cell, like a contour can not leave the cell it was found in. Only
+//components that do not reach the centre of their cell are leftovers of the grid lines and are dropped, a
+//digit touching such a leftover has its centroid pulled towards the margin but still reaches the centre.
+//cells is the grid without lines with dark digits on a light background, the image splitGrid cuts the cells from.
+void DetectGrid::findDigitComponents(Mat cells, GridDigits& digits)
+{
+    digits.ink = thresholdCell(blurCell(cells));
+    for (int x = 0; x < 9; x++) {
+        for (int y = 0; y < 9; y++) {
+            digits.rects[x][y].clear();
+        }
+    }
+
+    Mat labels;
+    Mat stats;
+    Mat centroids;
+    int count = connectedComponentsWithStats(digits.ink, labels, stats, centroids, 8, CV_32S);
+    for (int i = 1; i < count; i++)             //label 0 is the background
+    {
+        int x = int(centroids.at<double>(i, 0)) / CELL_SIZE;
+        int y = int(centroids.at<double>(i, 1)) / CELL_SIZE;
+        if (x < 0 || x >= 9 || y < 0 || y >= 9) {
+            continue;
+        }
+        Rect cell(x * CELL_SIZE, y * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+        Rect centre(cell.x + CELL_MARGIN, cell.y + CELL_MARGIN, CELL_SIZE - 2 * CELL_MARGIN, CELL_SIZE - 2 * CELL_MARGIN);
+        Rect rect = Rect(stats.at<int>(i, CC_STAT_LEFT), stats.at<int>(i, CC_STAT_TOP),
+                         stats.at<int>(i, CC_STAT_WIDTH), stats.at<int>(i, CC_STAT_HEIGHT)) & cell;
+        if (rect.area() < MIN_DIGIT_AREA || stats.at<int>(i, CC_STAT_AREA) < MIN_INK_PIXELS || (rect & centre).empty()) {
+            continue;
+        }
+        digits.rects[x][y].push_back(rect);
+    }
+
+    for (int x = 0; x < 9; x++) {
+        for (int y = 0; y < 9; y++) {
+            sort(digits.rects[x][y].begin(), digits.rects[x][y].end(), [](const Rect& a, const Rect& b) { return a.x < b.x; });
+        }
+    }
+}
+
 //Function to assign every box in the grid to a position in an array
 void DetectGrid::splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9])
 {
-    //find the grid and remove the lines
+    bool emptyCells[9][9];
+    splitGrid(grayscaleGridSrc, gridArray, emptyCells);
+}
+
+//Function to assign every box in the grid to a position in an array and mark the empty boxes
+void DetectGrid::splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9], bool emptyCells[9][9])
+{
+    //find the grid and remove the lines, the digits are still white on black for the ink count
     Mat grid = removeGridLines(findGrid(grayscaleGridSrc));
+    findEmptyCells(grid, emptyCells);
+
+    //dark digits on a light background again, one pass over the grid and still one 8 bit channel
+    Mat cells;
+    bitwise_not(grid, cells);
+    splitCells(cells, gridArray);
+}
 
-    cvtColor(~grid,grid,COLOR_GRAY2BGR);
+//Function to assign every box in the grid to a position in an array and find the digits of every box with
+//one component pass, for recognizeGridDigits. A cell without a component is empty, no separate ink count.
+void DetectGrid::splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9], GridDigits& digits)
+{
+    //the component pass takes the cells as they are, dark digits on a light background
+    Mat cells;
+    bitwise_not(removeGridLines(findGrid(grayscaleGridSrc)), cells);
+    splitCells(cells, gridArray);
+    findDigitComponents(cells, digits);
+}
+
+//Function to cut the boxes out of the grid, the boxes are views into cells
+void DetectGrid::splitCells(Mat cells, Mat gridArray[9][9])
+{
     Mat smallimage;
 
     //split the full grid into smaller images each with the size of 50x50 pixels
-    for (int m=0; m < 450; m += 50)
+    for (int m=0; m < 450; m += CELL_SIZE)
     {
-        for (int n = 0; n < 450; n += 50)
+        for (int n = 0; n < 450; n += CELL_SIZE)
         {
-            smallimage = Mat(grid, Rect(n, m, 50, 50));
-            gridArray[n/50][m/50] = smallimage;
+            smallimage = Mat(cells, Rect(n, m, CELL_SIZE, CELL_SIZE));
+            gridArray[n/CELL_SIZE][m/CELL_SIZE] = smallimage;
         }
     }
 }
@@ -4,9 +4,14 @@
 #include "opencv2/core.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/opencv.hpp"
+#include "griddigits.h"
 
 #define UNASSIGNED 0 // UNASSIGNED is used for empty cells in sudoku
 #define N 9 // N is used for size of Sudoku grid. Size will be NxN
+#define CELL_SIZE 50 // size in pixels of one cell in the warped grid
+#define CELL_MARGIN 10 // pixels at each side of a cell that are not searched for ink, these hold the leftovers of the grid lines
+#define MIN_INK_PIXELS 25 // a cell with less ink than this in its centre is empty
+#define MIN_DIGIT_AREA 100 // bounding box area below which a component is noise, like MIN_CONTOUR_AREA for the contours of a cell
 
 using namespace cv;
 using namespace std;
@@ -23,10 +28,17 @@ private:
     int bottomLeft = 0;
     int topLeft = 0;
     int topRight = 0;
+    void splitCells(Mat cells, Mat gridArray[9][9]);
 public:
     Mat findGrid(Mat grayScaleSrc);
     Mat removeGridLines(Mat grid);
+    void findEmptyCells(Mat grid, bool emptyCells[9][9]);
+    void findDigitComponents(Mat cells, GridDigits& digits);
+    // gridArray[x][y] gets a CELL_SIZE x CELL_SIZE CV_8UC1 view (dark digit on a light background)
+    // into one grid image, this is what extractDigitSamples expects
     void splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9]);
+    void splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9], bool emptyCells[9][9]);
+    void splitGrid(Mat grayscaleGridSrc, Mat gridArray[9][9], GridDigits& digits);
 };
 
 #endif // DETECTGRID_H
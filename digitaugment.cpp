@@ -0,0 +1,83 @@
+#include "digitaugment.h"
+#include "opencv2/imgproc.hpp"
+#include <algorithm>
+
+//Function to distort one threshold digit (white on black, cropped to the digit) and crop the result to its ink again,
+//like numberRecognition crops a digit to its bounding rect before the features are taken
+cv::Mat augmentDigit(const cv::Mat& matDigit, cv::RNG& rng, const AugmentOptions& options)
+{
+    //room around the digit so rotation and shift do not cut it off
+    int border = std::max(matDigit.cols, matDigit.rows) / 2 + 2;
+    cv::Mat matPadded;
+    cv::copyMakeBorder(matDigit, matPadded, border, border, border, border, cv::BORDER_CONSTANT, cv::Scalar(0));
+
+    double angle = rng.uniform(-options.maxRotation, options.maxRotation);
+    double scale = 1.0 + rng.uniform(-options.maxScale, options.maxScale);
+    cv::Point2f centre(matPadded.cols / 2.0f, matPadded.rows / 2.0f);
+    cv::Mat transform = cv::getRotationMatrix2D(centre, angle, scale);
+    transform.at<double>(0, 2) += rng.uniform(-options.maxShift, options.maxShift) * matDigit.cols;
+    transform.at<double>(1, 2) += rng.uniform(-options.maxShift, options.maxShift) * matDigit.rows;
+
+    cv::Mat matWarped;
+    cv::warpAffine(matPadded, matWarped, transform, matPadded.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::threshold(matWarped, matWarped, 127, 255, cv::THRESH_BINARY);
+
+    //thicker or thinner strokes, like a blurred or a sharp webcam frame after the threshold
+    double stroke = rng.uniform(0.0, 1.0);
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2, 2));
+    if (stroke < options.strokeChange) {
+        cv::dilate(matWarped, matWarped, kernel);
+    }
+    else if (stroke < 2 * options.strokeChange) {
+        cv::Mat matThin;
+        cv::erode(matWarped, matThin, kernel);
+        if (cv::countNonZero(matThin) > 0) matWarped = matThin;         // a thin digit must not vanish
+    }
+
+    std::vector<cv::Point> ink;
+    cv::findNonZero(matWarped, ink);
+    if (ink.empty()) {
+        return matDigit;
+    }
+    cv::Mat matCropped = matWarped(cv::boundingRect(ink)).clone();
+
+    //salt and pepper noise, only inside the crop: noise on the padded canvas would stretch the bounding rect
+    //and shrink the digit in it
+    int flips = int(options.noise * matCropped.total());
+    for (int i = 0; i < flips; i++) {
+        uchar& pixel = matCropped.at<uchar>(rng.uniform(0, matCropped.rows), rng.uniform(0, matCropped.cols));
+        pixel = uchar(255 - pixel);
+    }
+    return matCropped;
+}
+
+//Function to make the feature rows of every image and of its options.variants distorted copies, in that order.
+//Each image is handled by one task that writes its rows straight into the preallocated matrix, so besides the
+//result only one image per thread is in memory, whatever the number of variants.
+cv::Mat augmentedSamples(const std::vector<cv::Mat>& images, const cv::Mat& labels, FeatureType type,
+                         const AugmentOptions& options, cv::Mat& augmentedLabels, ThreadPool* pool)
+{
+    int rowsPerImage = 1 + std::max(0, options.variants);
+    cv::Mat samples(int(images.size()) * rowsPerImage, featureLength(type), CV_32F);
+    augmentedLabels.create(samples.rows, 1, CV_32S);
+
+    auto augmentImage = [&](int i) {
+        int firstRow = i * rowsPerImage;
+        for (int variant = 0; variant < rowsPerImage; variant++) {
+            augmentedLabels.at<int>(firstRow + variant) = labels.at<int>(i);
+            if (variant == 0) {
+                extractFeatures(images[size_t(i)], type).copyTo(samples.row(firstRow));
+                continue;
+            }
+            cv::RNG rng(options.seed * 0x9E3779B97F4A7C15ull + uint64_t(firstRow + variant) * 0xBF58476D1CE4E5B9ull + 1);
+            extractFeatures(augmentDigit(images[size_t(i)], rng, options), type).copyTo(samples.row(firstRow + variant));
+        }
+    };
+    if (pool) {
+        pool->parallelFor(int(images.size()), augmentImage);
+    }
+    else {
+        for (int i = 0; i < int(images.size()); i++) augmentImage(i);
+    }
+    return samples;
+}
@@ -0,0 +1,28 @@
+#ifndef DIGITAUGMENT_H
+#define DIGITAUGMENT_H
+
+#include "opencv2/core.hpp"
+#include "digitfeatures.h"
+#include "threadpool.h"
+#include <cstdint>
+#include <vector>
+
+// Random distortions that make a clean training digit look like a webcam digit.
+// Every variant gets its own generator seeded from seed, the image index and the
+// variant number, so the augmented set is the same for any thread count.
+struct AugmentOptions
+{
+    int variants = 0;                   // distorted copies per image, next to the original
+    float maxRotation = 8.0f;           // degrees, either way
+    float maxScale = 0.12f;             // relative, either way
+    float maxShift = 0.08f;             // fraction of the digit size, either way
+    float strokeChange = 0.3f;          // chance to thicken and, as often, to thin the strokes
+    float noise = 0.01f;                // fraction of the pixels flipped
+    uint64_t seed = 1;
+};
+
+cv::Mat augmentDigit(const cv::Mat& matDigit, cv::RNG& rng, const AugmentOptions& options);
+cv::Mat augmentedSamples(const std::vector<cv::Mat>& images, const cv::Mat& labels, FeatureType type,
+                         const AugmentOptions& options, cv::Mat& augmentedLabels, ThreadPool* pool = nullptr);
+
+#endif // DIGITAUGMENT_H
@@ -0,0 +1,556 @@
+#include "digitclassifier.h"
+#include "knnkernel.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+
+static std::atomic<uint64_t> nextModelId(1);
+
+// digits that look alike, a vote between the two of them goes to the second stage of a cascade
+static const int CONFUSABLE_PAIRS[][2] = {{'1', '7'}, {'3', '8'}, {'5', '6'}};
+
+//Function to map the model file, only call this once
+bool DigitClassifier::load(const std::string& modelFile, ClassifierMode classifierMode)
+{
+    std::shared_ptr<DigitModel> newModel = std::make_shared<DigitModel>();
+    if (!newModel->open(modelFile)) {
+        return false;
+    }
+    return load(newModel, classifierMode);
+}
+
+//Function to use a model another classifier has mapped already, both see the same samples in the same order,
+//so a cascade over one mapping can not be torn by an append between two opens of the file
+bool DigitClassifier::load(std::shared_ptr<DigitModel> mappedModel, ClassifierMode classifierMode)
+{
+    if (!mappedModel || !mappedModel->isOpen()) {
+        std::cout << "error, no model is mapped\n\n";
+        return false;
+    }
+    DigitModelContents contents;
+    digitModelContents(*mappedModel, contents);
+    if (!create(contents, classifierMode)) {
+        return false;
+    }
+    openIndex(mappedModel->index(), mappedModel->indexSize());        // a view into the mapping like the samples
+    model = mappedModel;
+    return true;
+}
+
+//Function to use a model that is already in memory, labels are N x 1 CV_32S character codes and samples
+//N x featureLength CV_32F rows; with a PCA projection the samples are the projected ones, N x components.
+bool DigitClassifier::create(const DigitModelContents& contents, ClassifierMode classifierMode, int neighbours)
+{
+    int totalSamples = contents.samples.rows;
+    for (const cv::Mat& appended : contents.appendedSamples) {
+        totalSamples += appended.rows;
+    }
+    if (totalSamples == 0) {
+        std::cout << "error, the model holds no samples\n\n";
+        return false;
+    }
+    if (contents.appendedLabels.size() != contents.appendedSamples.size()) {
+        std::cout << "error, " << contents.appendedLabels.size() << " label segments for " << contents.appendedSamples.size() << " sample segments\n\n";
+        return false;
+    }
+    if (classifierMode == CLASSIFIER_NET) {
+        std::cout << "error, a network is read with loadNet\n\n";
+        return false;
+    }
+    if (neighbours < 1 || neighbours > 16) {
+        std::cout << "error, the vote takes 1 to 16 neighbours, not " << neighbours << "\n\n";
+        return false;
+    }
+    if (classifierMode == CLASSIFIER_BINARY && (!contents.projectionVectors.empty() || contents.featureType != FEATURE_PIXELS)) {
+        std::cout << "error, binary mode needs an unprojected model of pixel features\n\n";
+        return false;
+    }
+
+    model.reset();
+    net.reset();
+    secondStage.reset();
+    id = nextModelId++;
+    features = contents.featureType;
+    labels = contents.labels.isContinuous() ? contents.labels : contents.labels.clone();
+    sampleBlocks.assign(1, contents.samples.isContinuous() ? contents.samples : contents.samples.clone());
+    for (size_t i = 0; i < contents.appendedSamples.size(); i++) {
+        //appended samples are searched where they are, only the small label column is copied into one piece
+        cv::vconcat(labels.reshape(1, int(labels.total())), contents.appendedLabels[i].reshape(1, int(contents.appendedLabels[i].total())), labels);
+        const cv::Mat& appended = contents.appendedSamples[i];
+        sampleBlocks.push_back(appended.isContinuous() ? appended : appended.clone());
+    }
+    correctionLabels.release();
+    correctionSamples.release();
+    correctionTemplates.clear();
+    sampleCount = totalSamples;
+    sampleLength = contents.samples.cols;
+    mode = classifierMode;
+    k = neighbours;
+
+    binaryTemplates.reset();
+    templateWords = 0;
+    if (mode == CLASSIFIER_BINARY) {
+        templateWords = binaryTemplateWords(sampleLength);
+        std::shared_ptr<std::vector<uint64_t> > templates = std::make_shared<std::vector<uint64_t> >(size_t(sampleCount) * templateWords);
+        size_t packed = 0;
+        for (const cv::Mat& block : sampleBlocks) {
+            if (block.rows > 0) {
+                packBinaryTemplates(block.ptr<float>(), block.rows, sampleLength, templates->data() + packed * templateWords);
+            }
+            packed += size_t(block.rows);
+        }
+        binaryTemplates = templates;
+        sampleBlocks.clear();
+    }
+
+    index = LshIndex();
+    indexBytes.reset();
+    if (!contents.index.empty()) {
+        indexBytes = std::make_shared<std::vector<uint8_t> >(contents.index);
+        openIndex(indexBytes->data(), indexBytes->size());
+    }
+
+    projectionVectors = contents.projectionVectors;
+    projectedMean.release();
+    if (!projectionVectors.empty()) {
+        cv::gemm(contents.projectionMean.reshape(1, 1), projectionVectors, 1, cv::Mat(), 0, projectedMean, cv::GEMM_2_T);
+    }
+    return true;
+}
+
+//Function to classify with a quantised network instead of the neighbour search, only call this once
+bool DigitClassifier::loadNet(const std::string& netFile)
+{
+    std::shared_ptr<DigitNet> newNet = std::make_shared<DigitNet>();
+    if (!newNet->load(netFile)) {
+        return false;
+    }
+    if (newNet->inputLength() != featureLength(FEATURE_PIXELS)) {
+        std::cout << "error, " << netFile << " does not take " << RESIZED_IMAGE_WIDTH << "x" << RESIZED_IMAGE_HEIGHT << " pixels\n\n";
+        return false;
+    }
+
+    model.reset();
+    labels.release();
+    sampleBlocks.clear();
+    correctionLabels.release();
+    correctionSamples.release();
+    correctionTemplates.clear();
+    index = LshIndex();
+    indexBytes.reset();
+    sampleCount = 0;
+    sampleLength = 0;
+    binaryTemplates.reset();
+    templateWords = 0;
+    projectionVectors.release();
+    projectedMean.release();
+    features = FEATURE_PIXELS;
+    mode = CLASSIFIER_NET;
+    net = newNet;
+    secondStage.reset();
+    id = nextModelId++;
+    return true;
+}
+
+//Function to make this classifier the cheap first stage of a cascade, only call this before sharing it.
+//Rows whose vote is won by less than margin of the neighbours, or goes between two digits that look alike,
+//are classified again by the second stage, which has to take the same features.
+bool DigitClassifier::setSecondStage(std::shared_ptr<const DigitClassifier> classifier, float margin)
+{
+    if (!isLoaded() || !classifier || !classifier->isLoaded() || classifier.get() == this) {
+        std::cout << "error, a cascade needs two loaded classifiers\n\n";
+        return false;
+    }
+    if (classifier->featureType() != features) {
+        std::cout << "error, the second stage takes " << featureTypeName(classifier->featureType()) << " features, not "
+                  << featureTypeName(features) << "\n\n";
+        return false;
+    }
+    secondStage = classifier;
+    secondStageMargin = margin;
+    id = nextModelId++;                 // the cascade answers differently than the first stage alone
+    return true;
+}
+
+//Function to learn from cells the user read out by hand without retraining: returns a copy of this classifier
+//with the labelled feature rows added, the model and its index are shared and only the earlier corrections
+//are copied. The rows are taken as they come out of the feature extraction, a projected model projects them.
+//The copy gets a new model id; publish it in place of this one.
+std::shared_ptr<DigitClassifier> DigitClassifier::withCorrections(const cv::Mat& newLabels, const cv::Mat& newSamples) const
+{
+    if (mode == CLASSIFIER_NET || !isLoaded()) {
+        std::cout << "error, only a loaded neighbour search can learn corrections\n\n";
+        return nullptr;
+    }
+    if (newSamples.rows == 0 || int(newLabels.total()) != newSamples.rows || newLabels.type() != CV_32S || newSamples.type() != CV_32F
+            || newSamples.cols != featureLength(features)) {
+        std::cout << "error, corrections need one label per row of " << featureLength(features) << " floats\n\n";
+        return nullptr;
+    }
+
+    std::shared_ptr<DigitClassifier> updated = std::make_shared<DigitClassifier>(*this);
+    if (secondStage) {
+        updated->secondStage = secondStage->withCorrections(newLabels, newSamples);
+        if (!updated->secondStage) {
+            return nullptr;
+        }
+    }
+    updated->id = nextModelId++;
+
+    cv::Mat rows;
+    if (!projectionVectors.empty()) {
+        project(newSamples, rows);
+    }
+    else {
+        rows = newSamples.isContinuous() ? newSamples : newSamples.clone();
+    }
+    updated->correctionLabels = correctionLabels.clone();          // the old classifier may still be in use, never grow its rows
+    updated->correctionLabels.push_back(newLabels.reshape(1, int(newLabels.total())));
+    updated->sampleCount = sampleCount + rows.rows;
+
+    if (mode == CLASSIFIER_BINARY) {
+        size_t start = updated->correctionTemplates.size();
+        updated->correctionTemplates.resize(start + size_t(rows.rows) * templateWords);
+        packBinaryTemplates(rows.ptr<float>(), rows.rows, sampleLength, updated->correctionTemplates.data() + start);
+        return updated;
+    }
+    updated->correctionSamples = correctionSamples.clone();
+    updated->correctionSamples.push_back(rows);
+    updated->index.add(rows.ptr<float>(), rows.rows);             // the copy of the index grows, this one is still in use
+    if (correctionSamples.empty()) {
+        updated->sampleBlocks.push_back(updated->correctionSamples);        // searched in full like an appended segment
+    }
+    else {
+        updated->sampleBlocks.back() = updated->correctionSamples;
+    }
+    return updated;
+}
+
+int DigitClassifier::correctionCount() const
+{
+    return correctionLabels.rows;
+}
+
+FeatureType DigitClassifier::featureType() const
+{
+    return features;
+}
+
+uint64_t DigitClassifier::modelId() const
+{
+    return id;
+}
+
+//Function to project N feature rows onto the PCA eigenvectors of the model
+void DigitClassifier::project(const cv::Mat& matSamples, cv::Mat& projected) const
+{
+    cv::gemm(matSamples, projectionVectors, 1, cv::Mat(), 0, projected, cv::GEMM_2_T);
+    for (int row = 0; row < projected.rows; row++) {
+        cv::Mat projectedRow = projected.row(row);
+        cv::subtract(projectedRow, projectedMean, projectedRow);
+    }
+}
+
+bool DigitClassifier::isLoaded() const
+{
+    return sampleCount > 0 || net;
+}
+
+//Function to take the neighbour index stored with the model, it is left out if it does not cover the first segment.
+//The rows of the appended segments go into its buckets in memory.
+void DigitClassifier::openIndex(const uint8_t* data, size_t size)
+{
+    if (!data || size == 0 || mode != CLASSIFIER_FLOAT) {
+        return;
+    }
+    if (!index.open(data, size) || index.sampleCount() != sampleBlocks[0].rows || index.dim() != sampleLength) {
+        std::cout << "error, the neighbour index does not match the model, searching all samples\n\n";
+        index = LshIndex();
+        return;
+    }
+    for (size_t i = 1; i < sampleBlocks.size(); i++) {
+        index.add(sampleBlocks[i].ptr<float>(), sampleBlocks[i].rows);
+    }
+}
+
+//Function to set how many buckets per table the neighbour index looks at, more finds more of the true
+//neighbours at more cost; 0 searches all samples. Only call this before sharing the classifier.
+void DigitClassifier::setIndexProbes(int probes)
+{
+    indexProbes = std::max(0, probes);
+}
+
+bool DigitClassifier::hasIndex() const
+{
+    return index.isOpen();
+}
+
+//Function to get the mapped model file, empty if the model was made with create() or this is a network
+std::shared_ptr<DigitModel> DigitClassifier::mappedModel() const
+{
+    return model;
+}
+
+bool DigitClassifier::isProjected() const
+{
+    return !projectionVectors.empty();
+}
+
+//Function to report the bytes the neighbour search reads, the float samples are only paged in when they are used
+size_t DigitClassifier::memoryUsage() const
+{
+    size_t secondStageBytes = secondStage ? secondStage->memoryUsage() : 0;
+    if (mode == CLASSIFIER_NET) {
+        return net->memoryUsage() + secondStageBytes;
+    }
+    size_t labelBytes = (labels.total() + correctionLabels.total()) * sizeof(int) + secondStageBytes;
+    labelBytes += index.memoryUsage();
+    if (mode == CLASSIFIER_BINARY) {
+        return labelBytes + (binaryTemplates->size() + correctionTemplates.size()) * sizeof(uint64_t);
+    }
+    size_t sampleValues = 0;
+    for (const cv::Mat& block : sampleBlocks) {
+        sampleValues += block.total();
+    }
+    return labelBytes + (sampleValues + projectionVectors.total() + projectedMean.total()) * sizeof(float);
+}
+
+//Function to look up the label of a sample, the corrections are numbered after the samples of the model
+int DigitClassifier::labelAt(int sample) const
+{
+    return sample < labels.rows ? labels.at<int>(sample) : correctionLabels.at<int>(sample - labels.rows);
+}
+
+//Function to rank the labels of the nearest samples by majority vote, on a tie the label that was seen first (the nearest one) wins
+DigitPrediction DigitClassifier::vote(const int* nearest, const float* distances, int neighbours) const
+{
+    int seenLabels[16];                 // distinct labels among the neighbours, k is well below 16
+    int seenVotes[16];
+    float seenDistances[16];
+    int seen = 0;
+    for (int i = 0; i < neighbours && i < 16; i++) {
+        int label = labelAt(nearest[i]);
+        int j = 0;
+        while (j < seen && seenLabels[j] != label) j++;
+        if (j == seen) {
+            seenLabels[seen] = label;
+            seenVotes[seen] = 0;
+            seenDistances[seen] = distances[i];         // neighbours are sorted, the first one of a label is its nearest
+            seen++;
+        }
+        seenVotes[j]++;
+    }
+
+    DigitPrediction prediction;
+    for (int c = 0; c < DIGIT_CANDIDATES && c < seen; c++) {
+        int best = c;
+        for (int j = c + 1; j < seen; j++) {
+            if (seenVotes[j] > seenVotes[best]) best = j;           // strictly more, so the nearer label stays ahead on a tie
+        }
+        //shift the labels in between down instead of swapping, so the ones left keep their nearest first order
+        std::rotate(seenLabels + c, seenLabels + best, seenLabels + best + 1);
+        std::rotate(seenVotes + c, seenVotes + best, seenVotes + best + 1);
+        std::rotate(seenDistances + c, seenDistances + best, seenDistances + best + 1);
+        prediction.labels[c] = seenLabels[c];
+        prediction.votes[c] = seenVotes[c];
+    }
+    prediction.confidence = float(seenVotes[0]) / float(neighbours);
+    prediction.distance = seenDistances[0];
+    return prediction;
+}
+
+//Function to merge the nearest ones of a block, numbered from blockStart, into the nearest ones found so far;
+//on equal distances the ones found so far stay first like in a single search
+static void mergeNearest(int* rowNearest, float* rowDistances, const int* newNearest, const float* newDistances,
+                         int neighbours, int blockStart)
+{
+    int mergedNearest[16];              // k is at most 16
+    float mergedDistances[16];
+    int a = 0;
+    int b = 0;
+    for (int i = 0; i < neighbours; i++) {
+        bool takeNew = newNearest[b] >= 0 && (rowNearest[a] < 0 || newDistances[b] < rowDistances[a]);
+        if (takeNew) {
+            mergedNearest[i] = blockStart + newNearest[b];
+            mergedDistances[i] = newDistances[b++];
+        }
+        else {
+            mergedNearest[i] = rowNearest[a];
+            mergedDistances[i] = rowDistances[a++];
+        }
+    }
+    std::copy(mergedNearest, mergedNearest + neighbours, rowNearest);
+    std::copy(mergedDistances, mergedDistances + neighbours, rowDistances);
+}
+
+//Function to find the k nearest samples over every segment of the model. The index holds the rows of all
+//segments and searches them at once, without it the nearest ones of each segment are merged, on equal
+//distances the sample from the older segment stays first like in a single search
+void DigitClassifier::nearestInBlocks(const cv::Mat& queries, int neighbours, cv::Mat& nearest, cv::Mat& distances) const
+{
+    if (index.isOpen() && indexProbes > 0) {
+        std::vector<LshBlock> blocks;
+        for (const cv::Mat& block : sampleBlocks) {
+            blocks.push_back(LshBlock{block.rows > 0 ? block.ptr<float>() : nullptr, block.rows});
+        }
+        index.search(queries.ptr<float>(), queries.rows, blocks, neighbours, indexProbes, nearest.ptr<int>(), distances.ptr<float>());
+        return;
+    }
+    if (sampleBlocks.size() == 1) {
+        nearestNeighbours(queries.ptr<float>(), queries.rows, sampleBlocks[0].ptr<float>(), sampleBlocks[0].rows, sampleLength,
+                          neighbours, nearest.ptr<int>(), distances.ptr<float>());
+        return;
+    }
+
+    nearest.setTo(-1);
+    distances.setTo(std::numeric_limits<float>::max());
+    std::vector<int> blockNearest(size_t(queries.rows) * neighbours);
+    std::vector<float> blockDistances(blockNearest.size());
+    int blockStart = 0;
+    for (const cv::Mat& block : sampleBlocks) {
+        if (block.rows == 0) {
+            continue;
+        }
+        nearestNeighbours(queries.ptr<float>(), queries.rows, block.ptr<float>(), block.rows, sampleLength,
+                          neighbours, blockNearest.data(), blockDistances.data());
+        for (int row = 0; row < queries.rows; row++) {
+            mergeNearest(nearest.ptr<int>(row), distances.ptr<float>(row), blockNearest.data() + size_t(row) * neighbours,
+                         blockDistances.data() + size_t(row) * neighbours, neighbours, blockStart);
+        }
+        blockStart += block.rows;
+    }
+}
+
+//Function to decide if the first stage of a cascade is too unsure about a prediction
+bool DigitClassifier::needsSecondStage(const DigitPrediction& prediction) const
+{
+    float margin = prediction.confidence;           // the network has no votes, its probability has to do
+    if (mode != CLASSIFIER_NET) {
+        margin = float(prediction.votes[0] - prediction.votes[1]) / float(std::min(k, sampleCount));
+    }
+    if (margin < secondStageMargin) {
+        return true;
+    }
+    if (prediction.votes[1] == 0) {
+        return false;                   // unanimous
+    }
+    for (const int* pair : CONFUSABLE_PAIRS) {
+        if ((prediction.labels[0] == pair[0] && prediction.labels[1] == pair[1])
+                || (prediction.labels[0] == pair[1] && prediction.labels[1] == pair[0])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//Function to send the rows the first stage is unsure about to the second stage in one batch
+void DigitClassifier::classifyHardRows(const cv::Mat& matSamples, std::vector<DigitPrediction>& predictions) const
+{
+    if (!secondStage) {
+        return;
+    }
+    std::vector<int> hardRows;
+    cv::Mat hardSamples;
+    for (int row = 0; row < matSamples.rows; row++) {
+        if (needsSecondStage(predictions[size_t(row)])) {
+            hardRows.push_back(row);
+            hardSamples.push_back(matSamples.row(row));
+        }
+    }
+    if (hardRows.empty()) {
+        return;
+    }
+    std::vector<DigitPrediction> secondPredictions;
+    secondStage->classifyBatch(hardSamples, secondPredictions);
+    for (size_t i = 0; i < hardRows.size(); i++) {
+        predictions[size_t(hardRows[i])] = secondPredictions[i];
+        predictions[size_t(hardRows[i])].stage = 2;
+    }
+}
+
+//Function to classify one feature row of an ROI, returns the character code of the digit
+int DigitClassifier::classify(const cv::Mat& matROIFlattenedFloat) const
+{
+    std::vector<int> intChars;
+    classifyBatch(matROIFlattenedFloat, intChars);
+    return intChars[0];
+}
+
+//Function to classify N feature rows (an N x featureLength float Mat) with a single neighbour search over the model
+void DigitClassifier::classifyBatch(const cv::Mat& matSamples, std::vector<int>& intChars) const
+{
+    std::vector<DigitPrediction> predictions;
+    classifyBatch(matSamples, predictions);
+    intChars.resize(predictions.size());
+    for (size_t row = 0; row < predictions.size(); row++) {
+        intChars[row] = predictions[row].labels[0];
+    }
+}
+
+//Function to classify N feature rows and keep the runner up labels and the confidence of every row
+void DigitClassifier::classifyBatch(const cv::Mat& matSamples, std::vector<DigitPrediction>& predictions) const
+{
+    predictions.assign(size_t(matSamples.rows), DigitPrediction());
+    if (matSamples.rows == 0) {
+        return;
+    }
+
+    if (mode == CLASSIFIER_NET) {
+        std::vector<float> probabilities(size_t(net->classCount()));
+        std::vector<int> order(probabilities.size());
+        for (int row = 0; row < matSamples.rows; row++) {
+            net->predict(matSamples.ptr<float>(row), probabilities.data());
+            for (size_t c = 0; c < order.size(); c++) order[c] = int(c);
+            int candidates = std::min(DIGIT_CANDIDATES, int(order.size()));
+            std::partial_sort(order.begin(), order.begin() + candidates, order.end(),
+                              [&](int a, int b) { return probabilities[size_t(a)] > probabilities[size_t(b)]; });
+            DigitPrediction& prediction = predictions[size_t(row)];
+            for (int c = 0; c < candidates; c++) {
+                prediction.labels[c] = net->classLabel(order[size_t(c)]);
+            }
+            prediction.confidence = probabilities[size_t(order[0])];
+        }
+        classifyHardRows(matSamples, predictions);
+        return;
+    }
+
+    cv::Mat queries = matSamples.isContinuous() ? matSamples : matSamples.clone();
+    if (!projectionVectors.empty()) {
+        project(matSamples, queries);           // the search runs in the reduced space of the model
+    }
+    int neighbours = std::min(k, sampleCount);
+    cv::Mat nearest(matSamples.rows, neighbours, CV_32S);
+    cv::Mat distances(matSamples.rows, neighbours, CV_32F);
+
+    if (mode == CLASSIFIER_BINARY) {
+        std::vector<uint64_t> queryTemplates(size_t(queries.rows) * templateWords);
+        packBinaryTemplates(queries.ptr<float>(), queries.rows, queries.cols, queryTemplates.data());
+
+        // k nearest templates of every row by number of differing pixels, sorted nearest first
+        cv::Mat pixelDistances(matSamples.rows, neighbours, CV_32S);
+        hammingNearestNeighbours(queryTemplates.data(), queries.rows, binaryTemplates->data(), labels.rows, templateWords,
+                                 neighbours, nearest.ptr<int>(), pixelDistances.ptr<int>());
+        pixelDistances.convertTo(distances, CV_32F);
+        if (!correctionTemplates.empty()) {
+            cv::Mat correctionNearest(matSamples.rows, neighbours, CV_32S);
+            cv::Mat correctionDistances;
+            hammingNearestNeighbours(queryTemplates.data(), queries.rows, correctionTemplates.data(), correctionLabels.rows,
+                                     templateWords, neighbours, correctionNearest.ptr<int>(), pixelDistances.ptr<int>());
+            pixelDistances.convertTo(correctionDistances, CV_32F);
+            for (int row = 0; row < matSamples.rows; row++) {
+                mergeNearest(nearest.ptr<int>(row), distances.ptr<float>(row), correctionNearest.ptr<int>(row),
+                             correctionDistances.ptr<float>(row), neighbours, labels.rows);
+            }
+        }
+    }
+    else {
+        // k nearest samples of every row by squared euclidean distance, sorted nearest first
+        nearestInBlocks(queries, neighbours, nearest, distances);
+    }
+
+    for (int row = 0; row < matSamples.rows; row++) {
+        predictions[size_t(row)] = vote(nearest.ptr<int>(row), distances.ptr<float>(row), neighbours);
+    }
+    classifyHardRows(matSamples, predictions);
+}
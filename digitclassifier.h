@@ -0,0 +1,96 @@
+#ifndef DIGITCLASSIFIER_H
+#define DIGITCLASSIFIER_H
+
+#include "opencv2/core.hpp"
+#include "digitmodel.h"
+#include "digitfeatures.h"
+#include "digitnet.h"
+#include "lshindex.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum ClassifierMode {
+    CLASSIFIER_FLOAT,           // euclidean distance over the 600 float pixels
+    CLASSIFIER_BINARY,          // hamming distance over 600 bit templates, 32x less memory, needs an unprojected model
+    CLASSIFIER_NET              // int8 quantised network from a weight file instead of the neighbour search
+};
+
+const int DIGIT_CANDIDATES = 3;             // labels kept per prediction, best first
+const int DEFAULT_NEIGHBOURS = 5;           // k of the neighbour vote
+const float CASCADE_MARGIN = 0.6f;          // a first stage vote won by less than this share of the neighbours goes to the second stage
+
+// Result for one feature row, taken from the same neighbour search that picks the label,
+// so callers can find the rows worth a second look without classifying again.
+struct DigitPrediction
+{
+    int labels[DIGIT_CANDIDATES] = {};      // character codes best first, 0 where fewer labels got a vote
+    int votes[DIGIT_CANDIDATES] = {};       // neighbours that voted for each label, unused by the network
+    float confidence = 0.0f;                // share of the votes for labels[0], or its softmax probability for the network
+    float distance = 0.0f;                  // distance to the nearest sample of labels[0], 0 for the network
+    int stage = 1;                          // 2 if the second stage of a cascade gave this prediction
+};
+
+// KNN digit classifier over a memory mapped DigitModel, or a quantised DigitNet
+// after loadNet(). Load it once at startup
+// and share it between all recognition calls; after load() the object is never
+// modified, so concurrent classify() calls from several threads are safe.
+// withCorrections() makes a new classifier that shares the model with this one
+// and adds a few samples on top, to be published in place of it.
+class DigitClassifier
+{
+private:
+    std::shared_ptr<DigitModel> model;
+    cv::Mat labels;                     // header into the mapped model file, a copy of all segments if samples were appended
+    std::vector<cv::Mat> sampleBlocks;  // one per model segment, headers into the mapping, released in binary mode;
+                                        // the corrections are the last block
+    cv::Mat correctionLabels;           // samples added by withCorrections, numbered after the ones of the model
+    cv::Mat correctionSamples;          // projected like the model, empty in binary mode
+    LshIndex index;                     // stored for the first segment, appended segments and corrections are added in memory
+    std::shared_ptr<std::vector<uint8_t> > indexBytes;     // only when the index did not come from the mapping
+    int indexProbes = LSH_DEFAULT_PROBES;
+    int sampleCount = 0;
+    int sampleLength = 0;
+    FeatureType features = FEATURE_PIXELS;
+    std::shared_ptr<const std::vector<uint64_t> > binaryTemplates;     // shared with the classifiers made by withCorrections
+    std::vector<uint64_t> correctionTemplates;
+    int templateWords = 0;
+    cv::Mat projectionVectors;          // PCA eigenvectors, empty if the model is not projected
+    cv::Mat projectedMean;              // PCA mean already multiplied by the eigenvectors
+    std::shared_ptr<DigitNet> net;      // only in net mode
+    std::shared_ptr<const DigitClassifier> secondStage;    // cascade: rows this one is unsure about are classified again
+    float secondStageMargin = CASCADE_MARGIN;
+    void project(const cv::Mat& matSamples, cv::Mat& projected) const;
+    ClassifierMode mode = CLASSIFIER_FLOAT;
+    uint64_t id = 0;                    // new for every create() and loadNet(), tells cached results of different models apart
+    int k = DEFAULT_NEIGHBOURS;
+    int labelAt(int sample) const;
+    DigitPrediction vote(const int* nearest, const float* distances, int neighbours) const;
+    void openIndex(const uint8_t* data, size_t size);
+    void nearestInBlocks(const cv::Mat& queries, int neighbours, cv::Mat& nearest, cv::Mat& distances) const;
+    bool needsSecondStage(const DigitPrediction& prediction) const;
+    void classifyHardRows(const cv::Mat& matSamples, std::vector<DigitPrediction>& predictions) const;
+public:
+    bool load(const std::string& modelFile, ClassifierMode classifierMode = CLASSIFIER_FLOAT);
+    bool load(std::shared_ptr<DigitModel> mappedModel, ClassifierMode classifierMode = CLASSIFIER_FLOAT);
+    bool create(const DigitModelContents& contents, ClassifierMode classifierMode = CLASSIFIER_FLOAT,
+                int neighbours = DEFAULT_NEIGHBOURS);
+    bool loadNet(const std::string& netFile);
+    bool setSecondStage(std::shared_ptr<const DigitClassifier> classifier, float margin = CASCADE_MARGIN);
+    std::shared_ptr<DigitClassifier> withCorrections(const cv::Mat& newLabels, const cv::Mat& newSamples) const;
+    int correctionCount() const;
+    void setIndexProbes(int probes);
+    bool hasIndex() const;
+    std::shared_ptr<DigitModel> mappedModel() const;
+    bool isLoaded() const;
+    bool isProjected() const;
+    FeatureType featureType() const;
+    uint64_t modelId() const;
+    size_t memoryUsage() const;
+    int classify(const cv::Mat& matROIFlattenedFloat) const;
+    void classifyBatch(const cv::Mat& matSamples, std::vector<int>& intChars) const;
+    void classifyBatch(const cv::Mat& matSamples, std::vector<DigitPrediction>& predictions) const;
+};
+
+#endif // DIGITCLASSIFIER_H
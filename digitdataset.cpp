@@ -0,0 +1,162 @@
+#include "digitdataset.h"
+#include "digitpack.h"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <iostream>
+#include <vector>
+
+//Function to list the files in one directory, sorted so every run sees the samples in the same order
+static std::vector<std::string> listFiles(const std::string& directory)
+{
+    std::vector<std::string> files;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return files;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            files.push_back(directory + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+//Function to list a labelled digit tree (directory/1 .. directory/9, one image per digit) with a character code label per file.
+//directory/0 holds empty cells, these are not digits so they are left out.
+bool listDigitFiles(const std::string& directory, std::vector<std::string>& files, std::vector<int>& labels)
+{
+    files.clear();
+    labels.clear();
+    for (int digit = 1; digit <= 9; digit++)
+    {
+        std::vector<std::string> digitFiles = listFiles(directory + "/" + std::to_string(digit));
+        files.insert(files.end(), digitFiles.begin(), digitFiles.end());
+        labels.insert(labels.end(), digitFiles.size(), int('0' + digit));
+    }
+    if (files.empty()) {
+        std::cout << "error, no digit images found in " << directory << "\n\n";
+        return false;
+    }
+    return true;
+}
+
+//Function to read one digit image as a threshold image, white digit on black like the ROIs numberRecognition cuts out
+cv::Mat decodeDigitImage(const std::string& file)
+{
+    cv::Mat matDigit = cv::imread(file, cv::IMREAD_GRAYSCALE);
+    cv::Mat matThresh;
+    if (!matDigit.empty()) {
+        cv::threshold(matDigit, matThresh, 127, 255, cv::THRESH_BINARY);        // the jpeg files are no longer pure black and white
+    }
+    return matThresh;
+}
+
+//Function to decode the listed files as threshold images, files that do not decode are left out together with their label.
+//With a pool the images are decoded in parallel, they keep the order of the file list.
+void decodeDigitImages(const std::vector<std::string>& files, const std::vector<int>& fileLabels,
+                       cv::Mat& labels, std::vector<cv::Mat>& images, ThreadPool* pool)
+{
+    labels.release();
+    images.clear();
+
+    std::vector<cv::Mat> decoded(files.size());
+    auto decode = [&](int i) { decoded[size_t(i)] = decodeDigitImage(files[size_t(i)]); };
+    if (pool) {
+        pool->parallelFor(int(files.size()), decode);
+    }
+    else {
+        for (int i = 0; i < int(files.size()); i++) decode(i);
+    }
+
+    for (size_t i = 0; i < decoded.size(); i++)
+    {
+        if (!decoded[i].empty()) {
+            images.push_back(decoded[i]);
+            labels.push_back(fileLabels[i]);
+        }
+    }
+}
+
+//Function to read a labelled digit tree, or a pack file made from one, as character code labels and threshold images
+bool loadDigitImages(const std::string& directory, cv::Mat& labels, std::vector<cv::Mat>& images, ThreadPool* pool)
+{
+    if (isDigitPack(directory)) {
+        return loadDigitPack(directory, labels, images);
+    }
+    std::vector<std::string> files;
+    std::vector<int> fileLabels;
+    if (!listDigitFiles(directory, files, fileLabels)) {
+        return false;
+    }
+    decodeDigitImages(files, fileLabels, labels, images, pool);
+    if (images.empty()) {
+        std::cout << "error, no digit images found in " << directory << "\n\n";
+        return false;
+    }
+    return true;
+}
+
+//Function to extract the features of every image, one row per image, every row is written by one thread
+cv::Mat digitImagesToSamples(const std::vector<cv::Mat>& images, FeatureType type, ThreadPool* pool)
+{
+    cv::Mat samples(int(images.size()), featureLength(type), CV_32F);
+    auto extract = [&](int i) { extractFeatures(images[size_t(i)], type).copyTo(samples.row(i)); };
+    if (pool) {
+        pool->parallelFor(int(images.size()), extract);
+    }
+    else {
+        for (int i = 0; i < int(images.size()); i++) extract(i);
+    }
+    return samples;
+}
+
+//Function to read a labelled digit tree, or a pack file made from one, as character code labels and feature rows
+bool loadDigitDataBase(const std::string& directory, cv::Mat& labels, cv::Mat& samples, FeatureType type, ThreadPool* pool)
+{
+    if (isDigitPack(directory)) {
+        return loadDigitPackSamples(directory, labels, samples, type, pool);
+    }
+    std::vector<cv::Mat> images;
+    if (!loadDigitImages(directory, labels, images, pool)) {
+        return false;
+    }
+    samples = digitImagesToSamples(images, type, pool);
+    return true;
+}
+
+//Function to split a dataset, every testEvery-th sample goes to the test set
+void splitTrainTest(const cv::Mat& labels, const cv::Mat& samples, int testEvery,
+                    cv::Mat& trainLabels, cv::Mat& trainSamples, cv::Mat& testLabels, cv::Mat& testSamples)
+{
+    trainLabels.release();
+    trainSamples.release();
+    testLabels.release();
+    testSamples.release();
+
+    for (int i = 0; i < samples.rows; i++)
+    {
+        if (i % testEvery == testEvery - 1) {
+            testLabels.push_back(labels.row(i));
+            testSamples.push_back(samples.row(i));
+        }
+        else {
+            trainLabels.push_back(labels.row(i));
+            trainSamples.push_back(samples.row(i));
+        }
+    }
+}
+
+//Function to get the percentage of samples the classifier labelled correctly
+double labelAccuracy(const std::vector<int>& intChars, const cv::Mat& labels)
+{
+    int correct = 0;
+    for (int i = 0; i < labels.rows; i++) {
+        if (intChars[size_t(i)] == labels.at<int>(i)) correct++;
+    }
+    return 100.0 * correct / labels.rows;
+}
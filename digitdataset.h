@@ -0,0 +1,24 @@
+#ifndef DIGITDATASET_H
+#define DIGITDATASET_H
+
+#include "opencv2/core.hpp"
+#include "digitfeatures.h"
+#include "threadpool.h"
+#include <string>
+#include <vector>
+
+const char* const DIGIT_DATABASE_DIR = "../SudokuSolver/digitDataBase";
+
+bool listDigitFiles(const std::string& directory, std::vector<std::string>& files, std::vector<int>& labels);
+cv::Mat decodeDigitImage(const std::string& file);
+void decodeDigitImages(const std::vector<std::string>& files, const std::vector<int>& fileLabels,
+                       cv::Mat& labels, std::vector<cv::Mat>& images, ThreadPool* pool = nullptr);
+bool loadDigitImages(const std::string& directory, cv::Mat& labels, std::vector<cv::Mat>& images, ThreadPool* pool = nullptr);
+cv::Mat digitImagesToSamples(const std::vector<cv::Mat>& images, FeatureType type, ThreadPool* pool = nullptr);
+bool loadDigitDataBase(const std::string& directory, cv::Mat& labels, cv::Mat& samples, FeatureType type = FEATURE_PIXELS,
+                       ThreadPool* pool = nullptr);
+void splitTrainTest(const cv::Mat& labels, const cv::Mat& samples, int testEvery,
+                    cv::Mat& trainLabels, cv::Mat& trainSamples, cv::Mat& testLabels, cv::Mat& testSamples);
+double labelAccuracy(const std::vector<int>& intChars, const cv::Mat& labels);
+
+#endif // DIGITDATASET_H
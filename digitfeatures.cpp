@@ -0,0 +1,105 @@
+#include "digitfeatures.h"
+#include "opencv2/imgproc.hpp"
+#include <algorithm>
+#include <cmath>
+
+int featureLength(FeatureType type)
+{
+    switch (type) {
+    case FEATURE_ZONING: return ZONING_COLUMNS * ZONING_ROWS;
+    case FEATURE_HOG: return (RESIZED_IMAGE_WIDTH / HOG_CELL_SIZE) * (RESIZED_IMAGE_HEIGHT / HOG_CELL_SIZE) * HOG_BINS;
+    default: return RESIZED_IMAGE_WIDTH * RESIZED_IMAGE_HEIGHT;
+    }
+}
+
+const char* featureTypeName(FeatureType type)
+{
+    switch (type) {
+    case FEATURE_ZONING: return "zoning";
+    case FEATURE_HOG: return "hog";
+    default: return "pixels";
+    }
+}
+
+//Function to find the feature type with the given name, for command line options
+bool featureTypeFromName(const std::string& name, FeatureType& type)
+{
+    for (int t = 0; t < FEATURE_TYPE_COUNT; t++) {
+        if (name == featureTypeName(FeatureType(t))) {
+            type = FeatureType(t);
+            return true;
+        }
+    }
+    return false;
+}
+
+//Function to flatten the resized threshold image, this is what the classifier always used
+static cv::Mat pixelFeatures(const cv::Mat& matROI)
+{
+    cv::Mat matROIResized;
+    cv::resize(matROI, matROIResized, cv::Size(RESIZED_IMAGE_WIDTH, RESIZED_IMAGE_HEIGHT));     // resize image, this will be more consistent for recognition and storage
+
+    cv::Mat matROIFloat;
+    matROIResized.convertTo(matROIFloat, CV_32FC1);             // convert Mat to float, necessary for the neighbour search
+
+    return matROIFloat.reshape(1, 1);
+}
+
+//Function to average the ink over a coarse grid of zones, area interpolation averages every source pixel of a zone
+static cv::Mat zoningFeatures(const cv::Mat& matROI)
+{
+    cv::Mat matZones;
+    cv::resize(matROI, matZones, cv::Size(ZONING_COLUMNS, ZONING_ROWS), 0, 0, cv::INTER_AREA);
+
+    cv::Mat matZonesFloat;
+    matZones.convertTo(matZonesFloat, CV_32FC1);
+    return matZonesFloat.reshape(1, 1);
+}
+
+//Function to build a histogram of gradient orientations per cell, weighted by gradient magnitude.
+//Every cell is normalised on its own, so thick and thin strokes of the same shape give close vectors.
+static cv::Mat hogFeatures(const cv::Mat& matROI)
+{
+    cv::Mat matROIResized;
+    cv::resize(matROI, matROIResized, cv::Size(RESIZED_IMAGE_WIDTH, RESIZED_IMAGE_HEIGHT));
+
+    cv::Mat gradX, gradY, magnitude, angle;
+    cv::Sobel(matROIResized, gradX, CV_32F, 1, 0, 1);
+    cv::Sobel(matROIResized, gradY, CV_32F, 0, 1, 1);
+    cv::cartToPolar(gradX, gradY, magnitude, angle, true);
+
+    cv::Mat histogram = cv::Mat::zeros(1, featureLength(FEATURE_HOG), CV_32F);
+    float* bins = histogram.ptr<float>();
+    int cellColumns = RESIZED_IMAGE_WIDTH / HOG_CELL_SIZE;
+
+    for (int y = 0; y < RESIZED_IMAGE_HEIGHT; y++) {
+        const float* magnitudeRow = magnitude.ptr<float>(y);
+        const float* angleRow = angle.ptr<float>(y);
+        for (int x = 0; x < RESIZED_IMAGE_WIDTH; x++) {
+            float unsignedAngle = std::fmod(angleRow[x], 180.0f);           // a stroke edge and its opposite edge count the same
+            int bin = std::min(int(unsignedAngle * HOG_BINS / 180.0f), HOG_BINS - 1);
+            int cell = (y / HOG_CELL_SIZE) * cellColumns + x / HOG_CELL_SIZE;
+            bins[cell * HOG_BINS + bin] += magnitudeRow[x];
+        }
+    }
+
+    int cells = histogram.cols / HOG_BINS;
+    for (int cell = 0; cell < cells; cell++) {
+        cv::Mat cellHistogram = histogram.colRange(cell * HOG_BINS, (cell + 1) * HOG_BINS);
+        double length = cv::norm(cellHistogram);
+        if (length > 0) {
+            cellHistogram *= 255.0 / length;                // same range as the pixel features
+        }
+    }
+    return histogram;
+}
+
+//Function to describe one thresholded digit ROI (white on black, cropped to the digit) as a 1 x featureLength float row
+cv::Mat extractFeatures(const cv::Mat& matROI, FeatureType type)
+{
+    switch (type) {
+    case FEATURE_ZONING: return zoningFeatures(matROI);
+    case FEATURE_HOG: return hogFeatures(matROI);
+    default: return pixelFeatures(matROI);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef DIGITFEATURES_H
+#define DIGITFEATURES_H
+
+#include "opencv2/core.hpp"
+#include <string>
+
+const int RESIZED_IMAGE_WIDTH = 20;
+const int RESIZED_IMAGE_HEIGHT = 30;
+
+const int ZONING_COLUMNS = 4;
+const int ZONING_ROWS = 6;
+
+const int HOG_CELL_SIZE = 10;           // the 20x30 digit is split in 2x3 cells of 10x10 pixels
+const int HOG_BINS = 9;                 // unsigned orientation, 20 degrees per bin
+
+// How a digit ROI is turned into the vector the classifier compares. The value
+// is stored in the model file, so a model is always used with the features it
+// was trained on.
+enum FeatureType {
+    FEATURE_PIXELS = 0,         // the 20x30 resized threshold image, 600 values of 0..255
+    FEATURE_ZONING = 1,         // ink density of 4x6 zones, 24 values
+    FEATURE_HOG = 2             // gradient orientation histogram of 2x3 cells, 54 values
+};
+
+const int FEATURE_TYPE_COUNT = 3;
+
+int featureLength(FeatureType type);
+const char* featureTypeName(FeatureType type);
+bool featureTypeFromName(const std::string& name, FeatureType& type);
+cv::Mat extractFeatures(const cv::Mat& matROI, FeatureType type);
+
+#endif // DIGITFEATURES_H
@@ -0,0 +1,464 @@
+#include "digitmodel.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static const char DIGIT_MODEL_MAGIC[4] = {'S', 'D', 'K', 'M'};
+static const char DIGIT_SEGMENT_MAGIC[4] = {'S', 'D', 'K', 'A'};
+static const uint64_t DIGIT_MODEL_ALIGNMENT = 64;
+static const size_t DIGIT_MODEL_V1_HEADER_SIZE = 64;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + DIGIT_MODEL_ALIGNMENT - 1) / DIGIT_MODEL_ALIGNMENT * DIGIT_MODEL_ALIGNMENT;
+}
+
+//Function to check that count entries of stride bytes from offset lie inside a file of size bytes, written so
+//that values read from a damaged header can not wrap around
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size)
+{
+    return offset <= size && (stride == 0 || count <= (size - offset) / stride);
+}
+
+DigitModel::~DigitModel()
+{
+    close();
+}
+
+void DigitModel::close()
+{
+    file.close();
+    segments.clear();
+    opened = false;
+}
+
+//Function to map a model file into memory and check that its sections fit in the file
+bool DigitModel::open(const std::string& modelFile)
+{
+    close();
+    if (!file.open(modelFile, DIGIT_MODEL_V1_HEADER_SIZE)) {
+        return false;
+    }
+    size_t mappingSize = file.size();
+
+    //copy the header, the fields a version 1 file does not have stay zero
+    const DigitModelHeader* fileHeader = reinterpret_cast<const DigitModelHeader*>(file.data());
+    memset(&header, 0, sizeof(header));
+    if (fileHeader->version >= 2 && mappingSize >= sizeof(DigitModelHeader)) {
+        memcpy(&header, fileHeader, sizeof(DigitModelHeader));
+    }
+    else {
+        memcpy(&header, fileHeader, DIGIT_MODEL_V1_HEADER_SIZE);
+    }
+    if (header.inputLength == 0) {
+        header.inputLength = header.featureLength;
+    }
+
+    bool labelsFit = sectionFits(header.labelsOffset, header.sampleCount, sizeof(int32_t), mappingSize);
+    bool samplesFit = sectionFits(header.samplesOffset, header.sampleCount, uint64_t(header.featureLength) * sizeof(float), mappingSize);
+    bool projectionFits = sectionFits(header.projectionOffset, uint64_t(header.projectionComponents) + 1,
+                                      uint64_t(header.inputLength) * sizeof(float), mappingSize);
+    bool indexFits = sectionFits(header.indexOffset, header.indexSize, 1, mappingSize);
+
+    if (memcmp(header.magic, DIGIT_MODEL_MAGIC, sizeof(DIGIT_MODEL_MAGIC)) != 0
+            || header.version < 1 || header.version > DIGIT_MODEL_VERSION
+            || header.featureType >= uint32_t(FEATURE_TYPE_COUNT)
+            || header.inputLength != uint32_t(::featureLength(FeatureType(header.featureType)))
+            || (header.projectionComponents != 0 && header.projectionComponents != header.featureLength)
+            || !labelsFit || !samplesFit || !indexFits
+            || (header.projectionComponents != 0 && !projectionFits)) {
+        std::cout << "error, " << modelFile << " is not a valid version 1 to " << DIGIT_MODEL_VERSION << " model file\n\n";
+        close();
+        return false;
+    }
+
+    //walk the appended segments, anything after the last one counted in the header is an unfinished append
+    uint64_t segmentOffset = alignOffset(header.indexOffset + header.indexSize);
+    for (uint32_t i = 0; i < header.segmentCount; i++) {
+        DigitModelSegment segment;
+        memset(&segment, 0, sizeof(segment));
+        if (sectionFits(segmentOffset, 1, sizeof(segment), mappingSize)) {
+            memcpy(&segment, file.data() + segmentOffset, sizeof(segment));
+        }
+        bool segmentLabelsFit = sectionFits(segment.labelsOffset, segment.sampleCount, sizeof(int32_t), mappingSize);
+        bool segmentSamplesFit = sectionFits(segment.samplesOffset, segment.sampleCount,
+                                             uint64_t(header.featureLength) * sizeof(float), mappingSize);
+        if (segment.nextOffset == 0 || memcmp(segment.magic, DIGIT_SEGMENT_MAGIC, sizeof(DIGIT_SEGMENT_MAGIC)) != 0
+                || !segmentLabelsFit || !segmentSamplesFit || segment.nextOffset <= segmentOffset) {
+            std::cout << "error, appended segment " << i + 1 << " of " << modelFile << " is damaged\n\n";
+            close();
+            return false;
+        }
+        segments.push_back(segment);
+        segmentOffset = segment.nextOffset;
+    }
+    opened = true;
+    return true;
+}
+
+bool DigitModel::isOpen() const
+{
+    return opened;
+}
+
+int DigitModel::sampleCount() const
+{
+    if (!opened) return 0;
+    uint64_t count = header.sampleCount;
+    for (const DigitModelSegment& segment : segments) {
+        count += segment.sampleCount;
+    }
+    return int(count);
+}
+
+int DigitModel::featureLength() const
+{
+    return opened ? int(header.featureLength) : 0;
+}
+
+int DigitModel::inputLength() const
+{
+    return opened ? int(header.inputLength) : 0;
+}
+
+FeatureType DigitModel::featureType() const
+{
+    return FeatureType(header.featureType);
+}
+
+//number of sample blocks, 1 for a model that was never appended to
+int DigitModel::segmentCount() const
+{
+    return opened ? 1 + int(segments.size()) : 0;
+}
+
+//labels of one segment as a count x 1 CV_32S Mat pointing into the mapping
+cv::Mat DigitModel::labels(int segment) const
+{
+    if (!opened || segment < 0 || segment >= segmentCount()) return cv::Mat();
+    uint8_t* base = file.data();
+    if (segment == 0) {
+        return cv::Mat(int(header.sampleCount), 1, CV_32S, base + header.labelsOffset);
+    }
+    const DigitModelSegment& appended = segments[size_t(segment - 1)];
+    return cv::Mat(int(appended.sampleCount), 1, CV_32S, base + appended.labelsOffset);
+}
+
+//samples of one segment as a count x featureLength CV_32F Mat pointing into the mapping
+cv::Mat DigitModel::samples(int segment) const
+{
+    if (!opened || segment < 0 || segment >= segmentCount()) return cv::Mat();
+    uint8_t* base = file.data();
+    if (segment == 0) {
+        return cv::Mat(int(header.sampleCount), featureLength(), CV_32F, base + header.samplesOffset);
+    }
+    const DigitModelSegment& appended = segments[size_t(segment - 1)];
+    return cv::Mat(int(appended.sampleCount), featureLength(), CV_32F, base + appended.samplesOffset);
+}
+
+//PCA mean as a 1 x inputLength Mat, empty if the samples are not projected
+cv::Mat DigitModel::projectionMean() const
+{
+    if (!opened || header.projectionComponents == 0) return cv::Mat();
+    uint8_t* base = file.data();
+    return cv::Mat(1, inputLength(), CV_32F, base + header.projectionOffset);
+}
+
+//PCA eigenvectors as a projectionComponents x inputLength Mat, empty if the samples are not projected
+cv::Mat DigitModel::projectionVectors() const
+{
+    if (!opened || header.projectionComponents == 0) return cv::Mat();
+    uint8_t* base = file.data();
+    return cv::Mat(int(header.projectionComponents), inputLength(), CV_32F,
+                   base + header.projectionOffset + uint64_t(header.inputLength) * sizeof(float));
+}
+
+const uint8_t* DigitModel::index() const
+{
+    if (!opened || header.indexSize == 0) return nullptr;
+    return file.data() + header.indexOffset;
+}
+
+size_t DigitModel::indexSize() const
+{
+    return opened ? size_t(header.indexSize) : 0;
+}
+
+//Function to move a completely written file over the old one in one step
+static bool replaceFile(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    bool replaced = MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = rename(from.c_str(), to.c_str()) == 0;
+#endif
+    if (!replaced) {
+        std::cout << "error, unable to replace " << to << ", the new model is left in " << from << "\n\n";
+    }
+    return replaced;
+}
+
+//Function to write zero bytes up to the next section boundary
+static void writePadding(std::ostream& out, uint64_t from, uint64_t to)
+{
+    const char padding[DIGIT_MODEL_ALIGNMENT] = {0};
+    out.write(padding, std::streamsize(to - from));
+}
+
+//Function to write a model file, labels may be any integer type, samples and projection are stored as floats
+bool writeDigitModel(const std::string& modelFile, const DigitModelContents& contents)
+{
+    cv::Mat samples = contents.samples;
+    cv::Mat labels = contents.labels;
+    if (contents.appendedSamples.size() != contents.appendedLabels.size()) {
+        std::cout << "error, " << contents.appendedLabels.size() << " label segments for " << contents.appendedSamples.size() << " sample segments\n\n";
+        return false;
+    }
+    for (size_t i = 0; i < contents.appendedSamples.size(); i++) {
+        cv::vconcat(samples, contents.appendedSamples[i], samples);        //a rewrite stores everything as one section again
+        cv::vconcat(labels.reshape(1, int(labels.total())), contents.appendedLabels[i].reshape(1, int(contents.appendedLabels[i].total())), labels);
+    }
+    if (int(labels.total()) != samples.rows) {
+        std::cout << "error, " << labels.total() << " labels for " << samples.rows << " samples\n\n";
+        return false;
+    }
+    bool projected = !contents.projectionVectors.empty();
+    if (projected && (contents.projectionVectors.rows != samples.cols
+                      || contents.projectionMean.total() != size_t(contents.projectionVectors.cols))) {
+        std::cout << "error, the projection does not match the " << samples.cols << " long samples\n\n";
+        return false;
+    }
+
+    cv::Mat labelsInt;
+    cv::Mat samplesFloat;
+    cv::Mat projectionFloat;
+    labels.reshape(1, samples.rows).convertTo(labelsInt, CV_32S);
+    samples.convertTo(samplesFloat, CV_32F);
+    samplesFloat = samplesFloat.clone();                // make sure the rows are continuous
+    if (projected) {
+        cv::Mat mean;
+        contents.projectionMean.reshape(1, 1).convertTo(mean, CV_32F);
+        contents.projectionVectors.convertTo(projectionFloat, CV_32F);
+        cv::vconcat(mean, projectionFloat, projectionFloat);
+    }
+
+    DigitModelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DIGIT_MODEL_MAGIC, sizeof(DIGIT_MODEL_MAGIC));
+    header.version = DIGIT_MODEL_VERSION;
+    header.sampleCount = uint32_t(samples.rows);
+    header.featureLength = uint32_t(samples.cols);
+    header.inputLength = projected ? uint32_t(contents.projectionVectors.cols) : header.featureLength;
+    header.featureType = uint32_t(contents.featureType);
+    if (header.inputLength != uint32_t(featureLength(contents.featureType))) {
+        std::cout << "error, " << featureTypeName(contents.featureType) << " features are " << featureLength(contents.featureType)
+                  << " long, not " << header.inputLength << "\n\n";
+        return false;
+    }
+    header.projectionComponents = projected ? uint32_t(contents.projectionVectors.rows) : 0;
+    header.labelsOffset = sizeof(DigitModelHeader);
+    header.samplesOffset = alignOffset(header.labelsOffset + labelsInt.total() * sizeof(int32_t));
+    header.projectionOffset = alignOffset(header.samplesOffset + samplesFloat.total() * sizeof(float));
+    header.indexOffset = alignOffset(header.projectionOffset + projectionFloat.total() * sizeof(float));
+    header.indexSize = contents.index.size();
+    header.appendOffset = alignOffset(header.indexOffset + header.indexSize);
+
+    //write next to the model and rename it over, a running program that still maps the old file keeps its pages
+    std::string temporaryFile = modelFile + ".tmp";
+    std::ofstream out(temporaryFile, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "error, unable to open model file " << temporaryFile << " for writing\n\n";
+        return false;
+    }
+
+    uint64_t position = sizeof(header);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(labelsInt.data), std::streamsize(labelsInt.total() * sizeof(int32_t)));
+    position += labelsInt.total() * sizeof(int32_t);
+    writePadding(out, position, header.samplesOffset);
+    out.write(reinterpret_cast<const char*>(samplesFloat.data), std::streamsize(samplesFloat.total() * sizeof(float)));
+    position = header.samplesOffset + samplesFloat.total() * sizeof(float);
+    writePadding(out, position, header.projectionOffset);
+    if (projected) {
+        out.write(reinterpret_cast<const char*>(projectionFloat.data), std::streamsize(projectionFloat.total() * sizeof(float)));
+    }
+    position = header.projectionOffset + projectionFloat.total() * sizeof(float);
+    writePadding(out, position, header.indexOffset);
+    if (!contents.index.empty()) {
+        out.write(reinterpret_cast<const char*>(contents.index.data()), std::streamsize(contents.index.size()));
+    }
+    writePadding(out, header.indexOffset + header.indexSize, header.appendOffset);
+    out.close();
+    if (!out) {
+        std::cout << "error, unable to write model file " << temporaryFile << "\n\n";
+        return false;
+    }
+    return replaceFile(temporaryFile, modelFile);
+}
+
+bool writeDigitModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples)
+{
+    DigitModelContents contents;
+    contents.labels = labels;
+    contents.samples = samples;
+    return writeDigitModel(modelFile, contents);
+}
+
+//Function to add labelled samples to the end of an existing model without touching the samples already in it.
+//The samples are features of the model's type, they are projected here if the model is, so the cost only
+//depends on the number of new samples. The segment is written before the header counts it, an append that
+//fails halfway leaves the model as it was. Programs that have the model mapped, like the GUI while its
+//CorrectionWriter appends, keep their view of it: only bytes past the old end and the header are written,
+//and a mapped model works from the header it copied at open. On Windows MappedFile shares write access,
+//so the file can still be opened for the append. writtenHeader, if given, gets the header the file has now.
+bool appendDigitModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples, DigitModelHeader* writtenHeader)
+{
+    if (int(labels.total()) != samples.rows || samples.rows == 0) {
+        std::cout << "error, " << labels.total() << " labels for " << samples.rows << " samples\n\n";
+        return false;
+    }
+
+    //only the header and the projection are read from the model
+    DigitModelHeader header;
+    cv::Mat samplesFloat;
+    {
+        DigitModel model;
+        if (!model.open(modelFile)) {
+            return false;
+        }
+        if (model.header.version < 2) {
+            std::cout << "error, " << modelFile << " is a version 1 model, write it again before appending to it\n\n";
+            return false;
+        }
+        if (samples.cols != model.inputLength()) {
+            std::cout << "error, the model takes " << model.inputLength() << " long " << featureTypeName(model.featureType())
+                      << " features, not " << samples.cols << "\n\n";
+            return false;
+        }
+        samples.convertTo(samplesFloat, CV_32F);
+        if (!model.projectionVectors().empty()) {
+            cv::Mat mean = model.projectionMean();
+            cv::Mat centred(samplesFloat.rows, samplesFloat.cols, CV_32F);
+            for (int row = 0; row < samplesFloat.rows; row++) {
+                cv::Mat centredRow = centred.row(row);
+                cv::subtract(samplesFloat.row(row), mean, centredRow);
+            }
+            cv::gemm(centred, model.projectionVectors(), 1, cv::Mat(), 0, samplesFloat, cv::GEMM_2_T);
+        }
+        samplesFloat = samplesFloat.clone();            // make sure the rows are continuous
+        header = model.header;
+    }                                                   // only needed for reading, other mappings may stay open
+
+    cv::Mat labelsInt;
+    labels.reshape(1, samples.rows).convertTo(labelsInt, CV_32S);
+    if (header.segmentCount == 0) {
+        header.appendOffset = alignOffset(header.indexOffset + header.indexSize);   // version 2 files do not have the field yet
+    }
+
+    DigitModelSegment segment;
+    memset(&segment, 0, sizeof(segment));
+    memcpy(segment.magic, DIGIT_SEGMENT_MAGIC, sizeof(DIGIT_SEGMENT_MAGIC));
+    segment.sampleCount = uint32_t(samplesFloat.rows);
+    segment.labelsOffset = header.appendOffset + sizeof(segment);
+    segment.samplesOffset = alignOffset(segment.labelsOffset + labelsInt.total() * sizeof(int32_t));
+    segment.nextOffset = alignOffset(segment.samplesOffset + samplesFloat.total() * sizeof(float));
+
+    std::fstream out(modelFile, std::ios::binary | std::ios::in | std::ios::out);
+    if (!out) {
+        std::cout << "error, unable to open model file " << modelFile << " for writing\n\n";
+        return false;
+    }
+    out.seekp(std::streamoff(header.appendOffset));
+    out.write(reinterpret_cast<const char*>(&segment), sizeof(segment));
+    out.write(reinterpret_cast<const char*>(labelsInt.data), std::streamsize(labelsInt.total() * sizeof(int32_t)));
+    writePadding(out, segment.labelsOffset + labelsInt.total() * sizeof(int32_t), segment.samplesOffset);
+    out.write(reinterpret_cast<const char*>(samplesFloat.data), std::streamsize(samplesFloat.total() * sizeof(float)));
+    writePadding(out, segment.samplesOffset + samplesFloat.total() * sizeof(float), segment.nextOffset);
+    out.flush();
+
+    //only now count the segment
+    header.version = DIGIT_MODEL_VERSION;
+    header.segmentCount++;
+    header.appendOffset = segment.nextOffset;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cout << "error, unable to append to model file " << modelFile << "\n\n";
+        return false;
+    }
+    if (writtenHeader) {
+        *writtenHeader = header;
+    }
+    return true;
+}
+
+//Function to open a model file and fill contents with Mat headers that point into the mapping of model
+bool openDigitModel(const std::string& modelFile, DigitModel& model, DigitModelContents& contents)
+{
+    if (!model.open(modelFile)) {
+        return false;
+    }
+    digitModelContents(model, contents);
+    return true;
+}
+
+//Function to fill contents with Mat headers into an open model, without opening the file again
+void digitModelContents(const DigitModel& model, DigitModelContents& contents)
+{
+    contents.featureType = model.featureType();
+    contents.labels = model.labels();
+    contents.samples = model.samples();
+    contents.projectionMean = model.projectionMean();
+    contents.projectionVectors = model.projectionVectors();
+    contents.index.clear();
+    contents.appendedLabels.clear();
+    contents.appendedSamples.clear();
+    for (int segment = 1; segment < model.segmentCount(); segment++) {
+        contents.appendedLabels.push_back(model.labels(segment));
+        contents.appendedSamples.push_back(model.samples(segment));
+    }
+}
+
+//Function to convert the classifications.xml / images.xml pair written by older versions of the training program.
+//Nothing is written unless both files parse and hold the same number of samples, a half written or mismatched
+//pair leaves the model file as it is.
+bool convertXmlModel(const std::string& classificationsFile, const std::string& imagesFile, const std::string& modelFile)
+{
+    cv::Mat matClassificationInts;
+    cv::Mat matTrainingImagesAsFlattenedFloats;
+
+    try {
+        cv::FileStorage fsClassifications(classificationsFile, cv::FileStorage::READ);
+        if (fsClassifications.isOpened() == false) {
+            std::cout << "error, unable to open training classifications file\n\n";
+            return false;
+        }
+        fsClassifications["classifications"] >> matClassificationInts;
+        fsClassifications.release();
+
+        cv::FileStorage fsTrainingImages(imagesFile, cv::FileStorage::READ);
+        if (fsTrainingImages.isOpened() == false) {
+            std::cout << "error, unable to open training images file\n\n";
+            return false;
+        }
+        fsTrainingImages["images"] >> matTrainingImagesAsFlattenedFloats;
+        fsTrainingImages.release();
+    }
+    catch (const cv::Exception& exception) {
+        std::cout << "error, unable to read the xml training files: " << exception.what() << "\n\n";
+        return false;
+    }
+
+    if (matTrainingImagesAsFlattenedFloats.empty() || int(matClassificationInts.total()) != matTrainingImagesAsFlattenedFloats.rows) {
+        std::cout << "error, " << matClassificationInts.total() << " classifications for " << matTrainingImagesAsFlattenedFloats.rows
+                  << " training images, the xml files do not belong together\n\n";
+        return false;
+    }
+    return writeDigitModel(modelFile, matClassificationInts, matTrainingImagesAsFlattenedFloats);
+}
@@ -0,0 +1,120 @@
+#ifndef DIGITMODEL_H
+#define DIGITMODEL_H
+
+#include "opencv2/core.hpp"
+#include "digitfeatures.h"
+#include "mappedfile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const char* const DIGIT_MODEL_FILE = "../SudokuSolver/digits.model";
+const char* const CLASSIFICATIONS_FILE = "../SudokuSolver/classifications.xml";
+const char* const TRAINING_IMAGES_FILE = "../SudokuSolver/images.xml";
+
+const uint32_t DIGIT_MODEL_VERSION = 3;
+const int DIGIT_MODEL_MAX_SEGMENTS = 16;    // --append folds the appended segments into the samples past this many
+
+// On-disk layout of a digit model, all values little endian:
+//   DigitModelHeader
+//   int32 labels[sampleCount]
+//   float samples[sampleCount][featureLength]     (starts on a 64 byte boundary)
+//   float projection[1 + projectionComponents][inputLength]
+//                                                 (optional, the PCA mean followed by one eigenvector per row)
+//   uint8 index[indexSize]                        (optional, indexSize may be 0)
+//   DigitModelSegment, int32 labels[], float samples[]
+//                                                 (segmentCount times, written by appendDigitModel)
+// Every section starts on a 64 byte boundary. Version 1 files have a 64 byte
+// header without the projection fields and are still read, version 2 files
+// have no appended segments.
+struct DigitModelHeader
+{
+    char magic[4];              // "SDKM"
+    uint32_t version;
+    uint32_t sampleCount;
+    uint32_t featureLength;     // length of the stored samples, projectionComponents if the model is projected
+    uint64_t labelsOffset;
+    uint64_t samplesOffset;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+    // version 2
+    uint32_t inputLength;       // featureLength(featureType), the length before any projection
+    uint32_t projectionComponents;
+    uint64_t projectionOffset;
+    uint32_t featureType;       // FeatureType the samples were extracted with, 0 (pixels) in older files
+    // version 3
+    uint32_t segmentCount;      // appended segments, the first one starts on the boundary after the index
+    uint64_t appendOffset;      // end of the last segment, where the next one goes
+    uint8_t reserved[48];
+};
+
+// Header of a block of samples added to the end of an existing model file. The
+// samples have featureLength values, so they are already projected if the model is.
+struct DigitModelSegment
+{
+    char magic[4];              // "SDKA"
+    uint32_t sampleCount;
+    uint64_t labelsOffset;      // from the start of the file, like the offsets in DigitModelHeader
+    uint64_t samplesOffset;
+    uint64_t nextOffset;        // where the next segment starts
+    uint8_t reserved[32];
+};
+
+// Everything that goes into a model file, the optional parts may be left empty.
+struct DigitModelContents
+{
+    FeatureType featureType = FEATURE_PIXELS;
+    cv::Mat labels;                     // N x 1, character code of every sample
+    cv::Mat samples;                    // N x featureLength
+    cv::Mat projectionMean;             // 1 x inputLength
+    cv::Mat projectionVectors;          // featureLength x inputLength
+    std::vector<uint8_t> index;
+    std::vector<cv::Mat> appendedLabels;    // segments added by appendDigitModel, oldest first,
+    std::vector<cv::Mat> appendedSamples;   // writeDigitModel folds them into labels and samples
+};
+
+// Read-only view of a model file. The file is memory mapped, labels() and
+// samples() return Mat headers that point straight into the mapping, so
+// opening a model costs no parsing and no copy of the sample matrix.
+// Segment 0 is the sample section written by writeDigitModel, every segment
+// after it was added by appendDigitModel.
+class DigitModel
+{
+private:
+    MappedFile file;
+    DigitModelHeader header;
+    std::vector<DigitModelSegment> segments;    // copies of the appended segment headers
+    bool opened = false;
+    void close();
+    friend bool appendDigitModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples,
+                                 DigitModelHeader* writtenHeader);
+public:
+    DigitModel() = default;
+    DigitModel(const DigitModel&) = delete;
+    DigitModel& operator=(const DigitModel&) = delete;
+    ~DigitModel();
+
+    bool open(const std::string& modelFile);
+    bool isOpen() const;
+    int sampleCount() const;            // all segments together
+    int featureLength() const;
+    int inputLength() const;
+    FeatureType featureType() const;
+    int segmentCount() const;
+    cv::Mat labels(int segment = 0) const;
+    cv::Mat samples(int segment = 0) const;
+    cv::Mat projectionMean() const;
+    cv::Mat projectionVectors() const;
+    const uint8_t* index() const;
+    size_t indexSize() const;
+};
+
+bool writeDigitModel(const std::string& modelFile, const DigitModelContents& contents);
+bool writeDigitModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples);
+bool appendDigitModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples,
+                      DigitModelHeader* writtenHeader = nullptr);
+bool openDigitModel(const std::string& modelFile, DigitModel& model, DigitModelContents& contents);
+void digitModelContents(const DigitModel& model, DigitModelContents& contents);
+bool convertXmlModel(const std::string& classificationsFile, const std::string& imagesFile, const std::string& modelFile);
+
+#endif // DIGITMODEL_H
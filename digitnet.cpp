@@ -0,0 +1,399 @@
+#include "digitnet.h"
+#include "knnkernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DIGITNET_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define DIGITNET_TARGET_AVX2
+#else
+#define DIGITNET_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static const char DIGIT_NET_MAGIC[4] = {'S', 'D', 'K', 'N'};
+
+typedef int32_t (*DotFn)(const int8_t* a, const int8_t* b, int n);
+
+static int32_t dotScalar(const int8_t* a, const int8_t* b, int n)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += int32_t(a[i]) * int32_t(b[i]);
+    }
+    return sum;
+}
+
+#ifdef DIGITNET_X86
+static int32_t dotSse2(const int8_t* a, const int8_t* b, int n)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i signA = _mm_cmpgt_epi8(zero, va);           // sign extend the bytes to 16 bit
+        __m128i signB = _mm_cmpgt_epi8(zero, vb);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(va, signA), _mm_unpacklo_epi8(vb, signB)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(va, signA), _mm_unpackhi_epi8(vb, signB)));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+    int32_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return total + dotScalar(a + i, b + i, n - i);          // the tail that does not fill a register
+}
+
+DIGITNET_TARGET_AVX2 static int32_t dotAvx2(const int8_t* a, const int8_t* b, int n)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+    }
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum4);
+    int32_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return total + dotScalar(a + i, b + i, n - i);          // the tail that does not fill a register
+}
+#endif
+
+//Function to pick the int8 dot product for this CPU, same dispatch as the nearest neighbour kernels
+static DotFn dotFunction()
+{
+#ifdef DIGITNET_X86
+    if (knnKernelSupported(KNN_KERNEL_AVX2)) return dotAvx2;
+    return dotSse2;
+#else
+    return dotScalar;
+#endif
+}
+
+static inline int8_t quantise(float value, float scale)
+{
+    float steps = std::nearbyint(value / scale);
+    return int8_t(std::max(-127.0f, std::min(127.0f, steps)));
+}
+
+//Function to check the layers against each other and derive every layer's input and output shape
+bool DigitNet::resolveShapes()
+{
+    if (layers.empty() || layers[0].type == DIGITNET_MAXPOOL) {
+        std::cout << "error, a network has to start with a conv or dense layer\n\n";
+        return false;
+    }
+    if (layers.back().type != DIGITNET_DENSE || layers.back().outputs != int(labels.size())) {
+        std::cout << "error, the last layer has to be dense with one output per class\n\n";
+        return false;
+    }
+
+    int channels = 1, height = inputHeight, width = inputWidth;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        DigitNetLayer& layer = layers[i];
+        layer.inChannels = channels;
+        layer.inHeight = height;
+        layer.inWidth = width;
+
+        size_t fanIn = 0;
+        if (layer.type == DIGITNET_CONV) {
+            fanIn = size_t(channels) * layer.kernelSize * layer.kernelSize;
+            channels = layer.outputs;
+        }
+        else if (layer.type == DIGITNET_DENSE) {
+            fanIn = size_t(channels) * height * width;
+            channels = layer.outputs;
+            height = 1;
+            width = 1;
+        }
+        else if (layer.type == DIGITNET_MAXPOOL) {
+            if (layer.kernelSize < 1 || height < layer.kernelSize || width < layer.kernelSize) {
+                std::cout << "error, layer " << i << " pools " << layer.kernelSize << "x" << layer.kernelSize << " over " << width << "x" << height << "\n\n";
+                return false;
+            }
+            height /= layer.kernelSize;
+            width /= layer.kernelSize;
+        }
+        else {
+            std::cout << "error, layer " << i << " has unknown type " << layer.type << "\n\n";
+            return false;
+        }
+
+        if (layer.type != DIGITNET_MAXPOOL
+                && (layer.outputs < 1 || layer.weights.size() != fanIn * layer.outputs
+                    || layer.weightScales.size() != size_t(layer.outputs) || layer.bias.size() != size_t(layer.outputs))) {
+            std::cout << "error, the weights of layer " << i << " do not match its shape\n\n";
+            return false;
+        }
+
+        layer.outChannels = channels;
+        layer.outHeight = height;
+        layer.outWidth = width;
+
+        //the output is stored with the input scale of the next layer that computes something
+        layer.outputScale = 0.0f;
+        for (size_t next = i + 1; next < layers.size(); next++) {
+            if (layers[next].type != DIGITNET_MAXPOOL) {
+                layer.outputScale = layers[next].inputScale;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool DigitNet::create(int width, int height, const std::vector<int>& classLabels, const std::vector<DigitNetLayer>& netLayers)
+{
+    inputWidth = width;
+    inputHeight = height;
+    labels = classLabels;
+    layers = netLayers;
+    if (!resolveShapes()) {
+        layers.clear();
+        return false;
+    }
+    return true;
+}
+
+//Function to read count values, fails without allocating if the rest of the file is too short for them
+template<typename T>
+static bool readValues(std::ifstream& in, std::vector<T>& values, size_t count, uint64_t fileSize)
+{
+    std::streamoff position = in.tellg();
+    if (!in || position < 0 || uint64_t(position) > fileSize || count > (fileSize - uint64_t(position)) / sizeof(T)) {
+        return false;
+    }
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), std::streamsize(count * sizeof(T)));
+    return bool(in);
+}
+
+//Function to read a weight file, see digitnet.h for the layout
+bool DigitNet::load(const std::string& netFile)
+{
+    std::ifstream in(netFile, std::ios::binary | std::ios::ate);
+    if (!in) {
+        std::cout << "error, unable to open network file " << netFile << "\n\n";
+        return false;
+    }
+    uint64_t fileSize = uint64_t(in.tellg());
+    in.seekg(0);
+
+    char magic[4];
+    uint32_t header[5];             // version, inputWidth, inputHeight, layerCount, classCount
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || memcmp(magic, DIGIT_NET_MAGIC, sizeof(magic)) != 0 || header[0] != DIGIT_NET_VERSION) {
+        std::cout << "error, " << netFile << " is not a version " << DIGIT_NET_VERSION << " network file\n\n";
+        return false;
+    }
+    if (header[1] == 0 || header[1] > DIGIT_NET_MAX_OUTPUTS || header[2] == 0 || header[2] > DIGIT_NET_MAX_OUTPUTS
+            || header[3] > DIGIT_NET_MAX_LAYERS || header[4] > DIGIT_NET_MAX_OUTPUTS) {
+        std::cout << "error, " << netFile << " has sizes out of range\n\n";
+        return false;
+    }
+
+    std::vector<int32_t> classLabels;
+    std::vector<DigitNetLayer> netLayers(header[3]);
+    bool ok = readValues(in, classLabels, header[4], fileSize);
+    int channels = 1, height = int(header[2]), width = int(header[1]);         // shape so far, the fan in of a layer depends on it
+    for (size_t i = 0; ok && i < netLayers.size(); i++)
+    {
+        DigitNetLayer& layer = netLayers[i];
+        uint32_t fields[4];         // type, outputs, kernelSize, relu
+        in.read(reinterpret_cast<char*>(fields), sizeof(fields));
+        in.read(reinterpret_cast<char*>(&layer.inputScale), sizeof(layer.inputScale));
+        layer.type = DigitNetLayerType(fields[0]);
+        layer.outputs = int(fields[1]);
+        layer.kernelSize = int(fields[2]);
+        layer.relu = fields[3] != 0;
+        ok = bool(in);
+        if (!ok) {
+            break;
+        }
+        if (fields[1] > DIGIT_NET_MAX_OUTPUTS || fields[2] > DIGIT_NET_MAX_KERNEL) {
+            std::cout << "error, layer " << i + 1 << " of " << netFile << " has sizes out of range\n\n";
+            return false;
+        }
+        if (layer.type == DIGITNET_MAXPOOL) {
+            height /= std::max(layer.kernelSize, 1);
+            width /= std::max(layer.kernelSize, 1);
+            continue;
+        }
+        size_t fanIn = layer.type == DIGITNET_CONV ? size_t(channels) * layer.kernelSize * layer.kernelSize
+                                                   : size_t(channels) * height * width;
+        ok = readValues(in, layer.weights, fanIn * size_t(layer.outputs), fileSize)
+                && readValues(in, layer.weightScales, size_t(layer.outputs), fileSize)
+                && readValues(in, layer.bias, size_t(layer.outputs), fileSize);
+        channels = layer.outputs;
+        if (layer.type == DIGITNET_DENSE) {
+            height = width = 1;
+        }
+    }
+    if (!ok) {
+        std::cout << "error, " << netFile << " is truncated\n\n";
+        return false;
+    }
+    return create(int(header[1]), int(header[2]), std::vector<int>(classLabels.begin(), classLabels.end()), netLayers);
+}
+
+//Function to write the network in the weight file layout, for tools that quantise an offline trained network
+bool DigitNet::save(const std::string& netFile) const
+{
+    std::ofstream out(netFile, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "error, unable to open network file " << netFile << " for writing\n\n";
+        return false;
+    }
+    uint32_t header[5] = {DIGIT_NET_VERSION, uint32_t(inputWidth), uint32_t(inputHeight), uint32_t(layers.size()), uint32_t(labels.size())};
+    std::vector<int32_t> classLabels(labels.begin(), labels.end());
+    out.write(DIGIT_NET_MAGIC, sizeof(DIGIT_NET_MAGIC));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(classLabels.data()), std::streamsize(classLabels.size() * sizeof(int32_t)));
+    for (const DigitNetLayer& layer : layers)
+    {
+        uint32_t fields[4] = {uint32_t(layer.type), uint32_t(layer.outputs), uint32_t(layer.kernelSize), layer.relu ? 1u : 0u};
+        out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+        out.write(reinterpret_cast<const char*>(&layer.inputScale), sizeof(layer.inputScale));
+        out.write(reinterpret_cast<const char*>(layer.weights.data()), std::streamsize(layer.weights.size()));
+        out.write(reinterpret_cast<const char*>(layer.weightScales.data()), std::streamsize(layer.weightScales.size() * sizeof(float)));
+        out.write(reinterpret_cast<const char*>(layer.bias.data()), std::streamsize(layer.bias.size() * sizeof(int32_t)));
+    }
+    return bool(out);
+}
+
+bool DigitNet::isLoaded() const
+{
+    return !layers.empty();
+}
+
+int DigitNet::inputLength() const
+{
+    return inputWidth * inputHeight;
+}
+
+size_t DigitNet::memoryUsage() const
+{
+    size_t bytes = labels.size() * sizeof(int);
+    for (const DigitNetLayer& layer : layers) {
+        bytes += layer.weights.size() + layer.weightScales.size() * sizeof(float) + layer.bias.size() * sizeof(int32_t);
+    }
+    return bytes;
+}
+
+int DigitNet::classCount() const
+{
+    return int(labels.size());
+}
+
+int DigitNet::classLabel(int classIndex) const
+{
+    return labels[size_t(classIndex)];
+}
+
+//Function to run the network on one 20x30 pixel feature row and return the character code of the best class,
+//probabilities (classCount values, optional) gets the softmax of the last layer
+int DigitNet::predict(const float* pixels, float* probabilities) const
+{
+    static const DotFn dot = dotFunction();
+
+    //scratch buffers are kept per thread, so a prediction allocates nothing after the first one
+    thread_local std::vector<int8_t> activations;
+    thread_local std::vector<int8_t> nextActivations;
+    thread_local std::vector<int8_t> patch;
+    thread_local std::vector<float> logits;
+
+    activations.resize(size_t(inputLength()));
+    for (int i = 0; i < inputLength(); i++) {
+        activations[size_t(i)] = quantise(pixels[i] / 255.0f, layers[0].inputScale);
+    }
+
+    for (const DigitNetLayer& layer : layers)
+    {
+        size_t outputSize = size_t(layer.outChannels) * layer.outHeight * layer.outWidth;
+        bool last = layer.outputScale == 0.0f;
+        nextActivations.resize(outputSize);
+        if (last) logits.resize(outputSize);
+
+        if (layer.type == DIGITNET_MAXPOOL)
+        {
+            int k = layer.kernelSize;
+            for (int c = 0; c < layer.outChannels; c++) {
+                const int8_t* in = activations.data() + size_t(c) * layer.inHeight * layer.inWidth;
+                int8_t* out = nextActivations.data() + size_t(c) * layer.outHeight * layer.outWidth;
+                for (int y = 0; y < layer.outHeight; y++) {
+                    for (int x = 0; x < layer.outWidth; x++) {
+                        int8_t best = -127;
+                        for (int ky = 0; ky < k; ky++) {
+                            for (int kx = 0; kx < k; kx++) {
+                                best = std::max(best, in[(y * k + ky) * layer.inWidth + x * k + kx]);
+                            }
+                        }
+                        out[y * layer.outWidth + x] = best;
+                    }
+                }
+            }
+        }
+        else
+        {
+            int positions = layer.type == DIGITNET_CONV ? layer.outHeight * layer.outWidth : 1;
+            int fanIn = int(layer.weights.size()) / layer.outputs;
+            int pad = layer.kernelSize / 2;
+            patch.resize(size_t(fanIn));
+
+            for (int position = 0; position < positions; position++)
+            {
+                const int8_t* input = activations.data();
+                if (layer.type == DIGITNET_CONV) {
+                    //gather the zero padded kernelSize x kernelSize neighbourhood of every input channel
+                    int y = position / layer.outWidth;
+                    int x = position % layer.outWidth;
+                    int8_t* p = patch.data();
+                    for (int c = 0; c < layer.inChannels; c++) {
+                        const int8_t* channel = activations.data() + size_t(c) * layer.inHeight * layer.inWidth;
+                        for (int ky = 0; ky < layer.kernelSize; ky++) {
+                            int iy = y + ky - pad;
+                            for (int kx = 0; kx < layer.kernelSize; kx++) {
+                                int ix = x + kx - pad;
+                                bool inside = iy >= 0 && iy < layer.inHeight && ix >= 0 && ix < layer.inWidth;
+                                *p++ = inside ? channel[iy * layer.inWidth + ix] : 0;
+                            }
+                        }
+                    }
+                    input = patch.data();
+                }
+
+                for (int o = 0; o < layer.outputs; o++) {
+                    int32_t sum = dot(input, layer.weights.data() + size_t(o) * fanIn, fanIn) + layer.bias[size_t(o)];
+                    float value = float(sum) * layer.inputScale * layer.weightScales[size_t(o)];
+                    if (layer.relu) value = std::max(value, 0.0f);
+                    size_t index = size_t(o) * positions + position;
+                    if (last) logits[index] = value;
+                    else nextActivations[index] = quantise(value, layer.outputScale);
+                }
+            }
+        }
+        activations.swap(nextActivations);
+    }
+
+    size_t best = size_t(std::max_element(logits.begin(), logits.end()) - logits.begin());
+    if (probabilities) {
+        float sum = 0.0f;
+        for (size_t c = 0; c < logits.size(); c++) {
+            probabilities[c] = std::exp(logits[c] - logits[best]);         // shifted by the largest logit so exp cannot overflow
+            sum += probabilities[c];
+        }
+        for (size_t c = 0; c < logits.size(); c++) {
+            probabilities[c] /= sum;
+        }
+    }
+    return labels[best];
+}
@@ -0,0 +1,71 @@
+#ifndef DIGITNET_H
+#define DIGITNET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const char* const DIGIT_NET_FILE = "../SudokuSolver/digits.net";
+
+const uint32_t DIGIT_NET_VERSION = 1;
+const uint32_t DIGIT_NET_MAX_LAYERS = 64;           // sanity bounds for the sizes read from a weight file
+const uint32_t DIGIT_NET_MAX_OUTPUTS = 4096;        // per layer, also the most classes and the largest input side
+const uint32_t DIGIT_NET_MAX_KERNEL = 15;
+
+enum DigitNetLayerType {
+    DIGITNET_CONV = 1,          // 'same' padded, stride 1 convolution
+    DIGITNET_DENSE = 2,         // fully connected over the flattened input
+    DIGITNET_MAXPOOL = 3        // kernelSize x kernelSize max pooling with stride kernelSize
+};
+
+// One layer of a quantised network. Weights are symmetric int8 with one scale per
+// output, so weight * weightScale is the real weight. The layer input is int8 with
+// inputScale as real value of one step. Bias is int32 in units of inputScale * weightScale.
+struct DigitNetLayer
+{
+    DigitNetLayerType type = DIGITNET_DENSE;
+    int outputs = 0;                    // output channels (conv) or output values (dense), unused for maxpool
+    int kernelSize = 0;                 // conv and maxpool
+    bool relu = false;
+    float inputScale = 1.0f;            // unused for maxpool, pooling keeps the scale of its input
+    std::vector<int8_t> weights;        // outputs x fanIn, fanIn is inChannels * kernelSize^2 (conv) or the input size (dense)
+    std::vector<float> weightScales;    // outputs
+    std::vector<int32_t> bias;          // outputs
+
+    // shapes, derived from the previous layer when the network is loaded
+    int inChannels = 0, inHeight = 0, inWidth = 0;
+    int outChannels = 0, outHeight = 0, outWidth = 0;
+    float outputScale = 0.0f;           // input scale of the next conv or dense layer, 0 for the last layer
+};
+
+// Weight file layout, all values little endian:
+//   char magic[4] "SDKN", uint32 version, uint32 inputWidth, uint32 inputHeight,
+//   uint32 layerCount, uint32 classCount, int32 labels[classCount]
+//   per layer: uint32 type, uint32 outputs, uint32 kernelSize, uint32 relu, float inputScale,
+//              int8 weights[outputs * fanIn], float weightScales[outputs], int32 bias[outputs]
+// The input is one 20x30 pixel feature row (0..255), divided by 255 before the first layer.
+// The last layer has classCount outputs, the label of the largest one is the answer.
+//
+// Inference only: train offline and quantise into this format. After load() the
+// network is never modified, so predict() may be called from several threads.
+class DigitNet
+{
+private:
+    int inputWidth = 0;
+    int inputHeight = 0;
+    std::vector<int> labels;
+    std::vector<DigitNetLayer> layers;
+    bool resolveShapes();
+public:
+    bool load(const std::string& netFile);
+    bool create(int width, int height, const std::vector<int>& classLabels, const std::vector<DigitNetLayer>& netLayers);
+    bool save(const std::string& netFile) const;
+    bool isLoaded() const;
+    int inputLength() const;
+    size_t memoryUsage() const;
+    int classCount() const;
+    int classLabel(int classIndex) const;
+    int predict(const float* pixels, float* probabilities = nullptr) const;
+};
+
+#endif // DIGITNET_H
@@ -0,0 +1,205 @@
+#include "digitpack.h"
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char DIGIT_PACK_MAGIC[4] = {'S', 'D', 'K', 'D'};
+static const uint64_t DIGIT_PACK_ALIGNMENT = 64;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + DIGIT_PACK_ALIGNMENT - 1) / DIGIT_PACK_ALIGNMENT * DIGIT_PACK_ALIGNMENT;
+}
+
+//Function to check that count entries of stride bytes from offset lie inside size bytes, without wrapping around
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size)
+{
+    return offset <= size && (stride == 0 || count <= (size - offset) / stride);
+}
+
+DigitPack::~DigitPack()
+{
+    close();
+}
+
+void DigitPack::close()
+{
+    file.close();
+    opened = false;
+}
+
+//Function to map a pack file into memory and check that its sections fit in the file
+bool DigitPack::open(const std::string& packFile)
+{
+    close();
+    if (!file.open(packFile, sizeof(DigitPackHeader))) {
+        return false;
+    }
+    size_t mappingSize = file.size();
+
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, DIGIT_PACK_MAGIC, sizeof(DIGIT_PACK_MAGIC)) != 0 || header.version != DIGIT_PACK_VERSION
+            || !sectionFits(header.labelsOffset, header.sampleCount, sizeof(int32_t), mappingSize)
+            || !sectionFits(header.entriesOffset, header.sampleCount, sizeof(DigitPackEntry), mappingSize)
+            || !sectionFits(header.imagesOffset, header.imagesSize, 1, mappingSize)
+            || header.imagesSize > uint64_t(INT_MAX)) {
+        std::cout << "error, " << packFile << " is not a valid version " << DIGIT_PACK_VERSION << " pack file\n\n";
+        close();
+        return false;
+    }
+    //every image has to lie inside the image section, checked once here instead of on every image()
+    for (uint32_t i = 0; i < header.sampleCount; i++) {
+        const DigitPackEntry& entry = entries()[i];
+        if (entry.width == 0 || entry.height == 0 || entry.width > uint32_t(INT_MAX) || entry.height > uint32_t(INT_MAX)
+                || !sectionFits(entry.offset, entry.height, entry.width, header.imagesSize)) {
+            std::cout << "error, image " << i << " of " << packFile << " is damaged\n\n";
+            close();
+            return false;
+        }
+    }
+    opened = true;
+    return true;
+}
+
+bool DigitPack::isOpen() const
+{
+    return opened;
+}
+
+int DigitPack::sampleCount() const
+{
+    return opened ? int(header.sampleCount) : 0;
+}
+
+const DigitPackEntry* DigitPack::entries() const
+{
+    return reinterpret_cast<const DigitPackEntry*>(file.data() + header.entriesOffset);
+}
+
+//labels as a sampleCount x 1 CV_32S Mat pointing into the mapping
+cv::Mat DigitPack::labels() const
+{
+    if (!opened) return cv::Mat();
+    return cv::Mat(int(header.sampleCount), 1, CV_32S, file.data() + header.labelsOffset);
+}
+
+//one image as a height x width CV_8U Mat pointing into the mapping
+cv::Mat DigitPack::image(int sample) const
+{
+    if (!opened || sample < 0 || sample >= int(header.sampleCount)) return cv::Mat();
+    const DigitPackEntry& entry = entries()[sample];
+    return cv::Mat(int(entry.height), int(entry.width), CV_8U, file.data() + header.imagesOffset + entry.offset);
+}
+
+//Function to tell a pack file from a digit directory, the tools take either
+bool isDigitPack(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[4] = {0};
+    return in.read(magic, sizeof(magic)) && memcmp(magic, DIGIT_PACK_MAGIC, sizeof(DIGIT_PACK_MAGIC)) == 0;
+}
+
+//Function to write threshold images of any size with their character code labels as a pack file,
+//every image is stored as it is so a pack reads back the same images as the digit tree
+bool writeDigitPack(const std::string& packFile, const cv::Mat& labels, const std::vector<cv::Mat>& images)
+{
+    if (labels.total() != images.size()) {
+        std::cout << "error, " << labels.total() << " labels for " << images.size() << " images\n\n";
+        return false;
+    }
+    int count = int(images.size());
+    cv::Mat labelsInt;
+    labels.reshape(1, count).convertTo(labelsInt, CV_32S);
+    std::vector<DigitPackEntry> entries(static_cast<size_t>(count));
+    uint64_t imagesSize = 0;
+    for (int i = 0; i < count; i++) {
+        const cv::Mat& image = images[size_t(i)];
+        if (image.type() != CV_8UC1 || image.empty()) {
+            std::cout << "error, image " << i << " is not a single channel 8 bit threshold digit\n\n";
+            return false;
+        }
+        entries[size_t(i)].offset = imagesSize;
+        entries[size_t(i)].width = uint32_t(image.cols);
+        entries[size_t(i)].height = uint32_t(image.rows);
+        imagesSize += image.total();
+    }
+
+    DigitPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DIGIT_PACK_MAGIC, sizeof(DIGIT_PACK_MAGIC));
+    header.version = DIGIT_PACK_VERSION;
+    header.sampleCount = uint32_t(count);
+    header.labelsOffset = sizeof(DigitPackHeader);
+    uint64_t labelsEnd = header.labelsOffset + uint64_t(count) * sizeof(int32_t);
+    header.entriesOffset = alignOffset(labelsEnd);
+    uint64_t entriesEnd = header.entriesOffset + uint64_t(count) * sizeof(DigitPackEntry);
+    header.imagesOffset = alignOffset(entriesEnd);
+    header.imagesSize = imagesSize;
+
+    std::ofstream out(packFile, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "error, unable to open pack file " << packFile << " for writing\n\n";
+        return false;
+    }
+    const char padding[DIGIT_PACK_ALIGNMENT] = {0};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(labelsInt.data), std::streamsize(labelsInt.total() * sizeof(int32_t)));
+    out.write(padding, std::streamsize(header.entriesOffset - labelsEnd));
+    out.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(DigitPackEntry)));
+    out.write(padding, std::streamsize(header.imagesOffset - entriesEnd));
+    for (const cv::Mat& image : images) {
+        for (int row = 0; row < image.rows; row++) {             // a crop of a larger image is not continuous
+            out.write(reinterpret_cast<const char*>(image.ptr(row)), std::streamsize(image.cols));
+        }
+    }
+    out.close();
+    if (!out) {
+        std::cout << "error, unable to write pack file " << packFile << "\n\n";
+        return false;
+    }
+    return true;
+}
+
+//Function to read a pack file like loadDigitImages reads a digit tree, every image is copied out of the mapping
+bool loadDigitPack(const std::string& packFile, cv::Mat& labels, std::vector<cv::Mat>& images)
+{
+    DigitPack pack;
+    if (!pack.open(packFile)) {
+        return false;
+    }
+    if (pack.sampleCount() == 0) {
+        std::cout << "error, no digit images in " << packFile << "\n\n";
+        return false;
+    }
+    labels = pack.labels().clone();
+    images.resize(size_t(pack.sampleCount()));
+    for (int i = 0; i < pack.sampleCount(); i++) {
+        images[size_t(i)] = pack.image(i).clone();
+    }
+    return true;
+}
+
+//Function to read a pack file like loadDigitDataBase reads a digit tree, the features are taken straight from the mapping
+//on the threads of the pool, without a copy of the images
+bool loadDigitPackSamples(const std::string& packFile, cv::Mat& labels, cv::Mat& samples, FeatureType type, ThreadPool* pool)
+{
+    DigitPack pack;
+    if (!pack.open(packFile)) {
+        return false;
+    }
+    if (pack.sampleCount() == 0) {
+        std::cout << "error, no digit images in " << packFile << "\n\n";
+        return false;
+    }
+    labels = pack.labels().clone();
+    samples.create(pack.sampleCount(), featureLength(type), CV_32F);
+    auto extract = [&](int i) { extractFeatures(pack.image(i), type).copyTo(samples.row(i)); };
+    if (pool) {
+        pool->parallelFor(pack.sampleCount(), extract);
+    }
+    else {
+        for (int i = 0; i < pack.sampleCount(); i++) extract(i);
+    }
+    return true;
+}
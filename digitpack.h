@@ -0,0 +1,76 @@
+#ifndef DIGITPACK_H
+#define DIGITPACK_H
+
+#include "opencv2/core.hpp"
+#include "digitfeatures.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const char* const DIGIT_PACK_FILE = "../SudokuSolver/digitDataBase.pack";
+
+const uint32_t DIGIT_PACK_VERSION = 2;
+
+// On-disk layout of a labelled digit tree packed into one file, like the MNIST
+// idx files, all values little endian:
+//   DigitPackHeader
+//   int32 labels[sampleCount]                     (character code of every image)
+//   DigitPackEntry entries[sampleCount]           (starts on a 64 byte boundary)
+//   uint8 images[imagesSize]                      (starts on a 64 byte boundary)
+// Every image is the threshold digit as it was cropped, at its own size, so the
+// features, augmentation and the parameter sweep see the same image as from the
+// digit tree. Version 1 packs held resized images and are no longer read.
+struct DigitPackHeader
+{
+    char magic[4];              // "SDKD"
+    uint32_t version;
+    uint32_t sampleCount;
+    uint32_t reserved0[3];
+    uint64_t labelsOffset;
+    uint64_t entriesOffset;
+    uint64_t imagesOffset;
+    uint64_t imagesSize;
+    uint8_t reserved[8];
+};
+
+// Where one image lies in the image section and its size, rows of width bytes
+struct DigitPackEntry
+{
+    uint64_t offset;            // from imagesOffset
+    uint32_t width;
+    uint32_t height;
+};
+
+// Read-only view of a pack file. The file is memory mapped like a DigitModel,
+// labels() and image() return Mat headers that point straight into the mapping,
+// so a tool reads 100k digits with one open instead of 100k jpeg decodes.
+class DigitPack
+{
+private:
+    MappedFile file;
+    DigitPackHeader header;
+    bool opened = false;
+    void close();
+    const DigitPackEntry* entries() const;
+public:
+    DigitPack() = default;
+    DigitPack(const DigitPack&) = delete;
+    DigitPack& operator=(const DigitPack&) = delete;
+    ~DigitPack();
+
+    bool open(const std::string& packFile);
+    bool isOpen() const;
+    int sampleCount() const;
+    cv::Mat labels() const;
+    cv::Mat image(int sample) const;
+};
+
+bool isDigitPack(const std::string& path);
+bool writeDigitPack(const std::string& packFile, const cv::Mat& labels, const std::vector<cv::Mat>& images);
+bool loadDigitPack(const std::string& packFile, cv::Mat& labels, std::vector<cv::Mat>& images);
+bool loadDigitPackSamples(const std::string& packFile, cv::Mat& labels, cv::Mat& samples, FeatureType type,
+                          ThreadPool* pool = nullptr);
+
+#endif // DIGITPACK_H
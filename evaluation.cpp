@@ -0,0 +1,202 @@
+#include "evaluation.h"
+#include "digitdataset.h"
+#include "trainingprogram.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+//Function to pick the value below which the given fraction of the sorted latencies lies (nearest rank)
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = size_t(std::ceil(fraction * double(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+//Function to run a classifier over a labelled test set and measure accuracy, confusion, latency and throughput
+EvaluationResult evaluateClassifier(const std::string& name, const DigitClassifier& classifier,
+                                    const cv::Mat& testSamples, const cv::Mat& testLabels)
+{
+    EvaluationResult result;
+    result.name = name;
+    result.samples = testSamples.rows;
+    result.modelBytes = classifier.memoryUsage();
+    result.confusion = cv::Mat::zeros(EVALUATION_CLASSES, EVALUATION_CLASSES + 1, CV_32S);
+    if (testSamples.rows == 0) {
+        return result;
+    }
+
+    //one sample at a time, the first call pages the model in and is not counted
+    classifier.classify(testSamples.row(0));
+    std::vector<int> intChars(size_t(testSamples.rows));
+    std::vector<double> latencies(size_t(testSamples.rows));
+    for (int row = 0; row < testSamples.rows; row++) {
+        cv::TickMeter timer;
+        timer.start();
+        intChars[size_t(row)] = classifier.classify(testSamples.row(row));
+        timer.stop();
+        latencies[size_t(row)] = timer.getTimeMicro();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.p50Us = percentile(latencies, 0.50);
+    result.p95Us = percentile(latencies, 0.95);
+    result.p99Us = percentile(latencies, 0.99);
+
+    //all samples in one batch, the way a whole grid or a training set is classified
+    std::vector<int> batchChars;
+    cv::TickMeter batchTimer;
+    batchTimer.start();
+    classifier.classifyBatch(testSamples, batchChars);
+    batchTimer.stop();
+    result.samplesPerSecond = testSamples.rows / batchTimer.getTimeSec();
+
+    result.accuracy = labelAccuracy(intChars, testLabels);
+    for (int row = 0; row < testSamples.rows; row++) {
+        int truth = testLabels.at<int>(row) - '1';
+        int predicted = intChars[size_t(row)] - '1';
+        if (truth < 0 || truth >= EVALUATION_CLASSES) continue;
+        if (predicted < 0 || predicted >= EVALUATION_CLASSES) predicted = EVALUATION_CLASSES;      // the "other" column
+        result.confusion.at<int>(truth, predicted)++;
+    }
+    return result;
+}
+
+//Function to print one evaluation with its confusion matrix for reading on the console
+void printEvaluation(const EvaluationResult& result)
+{
+    std::cout << result.name << ": " << result.samples << " samples, accuracy " << result.accuracy << " %, latency p50 "
+              << result.p50Us << " us, p95 " << result.p95Us << " us, p99 " << result.p99Us << " us, "
+              << result.samplesPerSecond << " samples per second, " << result.modelBytes << " bytes of model\n";
+    std::cout << "true\\predicted";
+    for (int c = 0; c < EVALUATION_CLASSES; c++) {
+        std::cout << std::setw(6) << c + 1;
+    }
+    std::cout << std::setw(7) << "other" << "\n";
+    for (int r = 0; r < EVALUATION_CLASSES; r++) {
+        std::cout << std::setw(14) << r + 1;
+        for (int c = 0; c <= EVALUATION_CLASSES; c++) {
+            std::cout << std::setw(c == EVALUATION_CLASSES ? 7 : 6) << result.confusion.at<int>(r, c);
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::endl;
+}
+
+//Function to store the results so runs can be compared, the format follows the extension (.json, .yml or .xml)
+bool writeEvaluations(const std::string& resultsFile, const std::vector<EvaluationResult>& results)
+{
+    cv::FileStorage fs(resultsFile, cv::FileStorage::WRITE);
+    if (fs.isOpened() == false) {
+        std::cout << "error, unable to open results file " << resultsFile << " for writing\n\n";
+        return false;
+    }
+    fs << "results" << "{";
+    for (const EvaluationResult& result : results) {
+        fs << result.name << "{";
+        fs << "samples" << result.samples;
+        fs << "accuracy" << result.accuracy;
+        fs << "p50_us" << result.p50Us;
+        fs << "p95_us" << result.p95Us;
+        fs << "p99_us" << result.p99Us;
+        fs << "samples_per_second" << result.samplesPerSecond;
+        fs << "model_bytes" << double(result.modelBytes);
+        fs << "confusion" << result.confusion;
+        fs << "}";
+    }
+    fs << "}";
+    fs.release();
+    return true;
+}
+
+//Function to compare results with an earlier results file, returns false if a classifier got less
+//accurate or slower than the allowed margins; classifiers the baseline does not have are skipped
+bool compareEvaluations(const std::string& baselineFile, const std::vector<EvaluationResult>& results)
+{
+    cv::FileStorage fs(baselineFile, cv::FileStorage::READ);
+    if (fs.isOpened() == false) {
+        std::cout << "error, unable to open baseline file " << baselineFile << "\n\n";
+        return false;
+    }
+    bool passed = true;
+    for (const EvaluationResult& result : results) {
+        cv::FileNode baseline = fs["results"][result.name];
+        if (baseline.empty()) {
+            std::cout << result.name << ": not in the baseline\n";
+            continue;
+        }
+        double baselineAccuracy = double(baseline["accuracy"]);
+        double baselineP95 = double(baseline["p95_us"]);
+        bool lessAccurate = result.accuracy < baselineAccuracy - REGRESSION_ACCURACY_POINTS;
+        bool slower = baselineP95 > 0.0 && result.p95Us > baselineP95 * REGRESSION_LATENCY_FACTOR;
+        std::cout << result.name << ": accuracy " << baselineAccuracy << " -> " << result.accuracy << " %, p95 "
+                  << baselineP95 << " -> " << result.p95Us << " us"
+                  << (lessAccurate ? ", ACCURACY REGRESSION" : "") << (slower ? ", LATENCY REGRESSION" : "") << "\n";
+        passed = passed && !lessAccurate && !slower;
+    }
+    std::cout << std::endl;
+    return passed;
+}
+
+//Function to evaluate every classifier mode on a train/test split of a labelled digit tree, write the results
+//and, with a baseline file, fail when accuracy or latency regressed
+bool evaluateDataBase(const std::string& dataBaseDirectory, const std::string& resultsFile, const std::string& baselineFile)
+{
+    cv::Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return false;
+    }
+    cv::Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+    std::cout << trainSamples.rows << " training samples, " << testSamples.rows << " test samples\n\n";
+
+    std::vector<EvaluationResult> results;
+    const ClassifierMode modes[] = {CLASSIFIER_FLOAT, CLASSIFIER_BINARY};
+    const char* const modeNames[] = {"float_knn", "binary_knn"};
+    for (int m = 0; m < 2; m++)
+    {
+        DigitModelContents contents;
+        contents.labels = trainLabels;
+        contents.samples = trainSamples;
+        DigitClassifier classifier;
+        if (classifier.create(contents, modes[m])) {
+            results.push_back(evaluateClassifier(modeNames[m], classifier, testSamples, testLabels));
+        }
+    }
+
+    DigitModelContents contents;
+    contents.labels = trainLabels;
+    contents.samples = trainSamples;
+    std::shared_ptr<DigitClassifier> secondStage = std::make_shared<DigitClassifier>();
+    DigitClassifier cascade;
+    if (secondStage->create(contents) && cascade.create(contents, CLASSIFIER_BINARY) && cascade.setSecondStage(secondStage)) {
+        results.push_back(evaluateClassifier("cascade_knn", cascade, testSamples, testLabels));
+    }
+
+    DigitModelContents projected;
+    projected.labels = trainLabels;
+    fitProjection(trainSamples, 32, projected.projectionMean, projected.projectionVectors, projected.samples);
+    DigitClassifier projectedClassifier;
+    if (projectedClassifier.create(projected)) {
+        results.push_back(evaluateClassifier("pca32_knn", projectedClassifier, testSamples, testLabels));
+    }
+
+    //the network is trained elsewhere, so its score on this test set is only comparable between runs
+    DigitClassifier net;
+    if (std::ifstream(DIGIT_NET_FILE).good() && net.loadNet(DIGIT_NET_FILE)) {
+        results.push_back(evaluateClassifier("int8_net", net, testSamples, testLabels));
+    }
+
+    for (const EvaluationResult& result : results) {
+        printEvaluation(result);
+    }
+    bool written = writeEvaluations(resultsFile, results);
+    if (written) {
+        std::cout << "results written to " << resultsFile << "\n\n";
+    }
+    if (!baselineFile.empty()) {
+        return compareEvaluations(baselineFile, results) && written;
+    }
+    return written;
+}
@@ -0,0 +1,36 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include "opencv2/core.hpp"
+#include "digitclassifier.h"
+#include <string>
+#include <vector>
+
+const int EVALUATION_CLASSES = 9;               // digits 1 to 9, anything else lands in an extra "other" column
+const double REGRESSION_ACCURACY_POINTS = 0.5;  // accuracy may drop this many percent points against a baseline
+const double REGRESSION_LATENCY_FACTOR = 1.25;  // p95 latency may grow this much against a baseline
+
+// Accuracy and speed of one classifier on a labelled test set. Latency is measured one
+// sample at a time like a grid cell is recognised, throughput with one batch of all samples.
+struct EvaluationResult
+{
+    std::string name;                   // key in the results file, letters, digits and underscores only
+    int samples = 0;
+    double accuracy = 0.0;              // percent
+    cv::Mat confusion;                  // EVALUATION_CLASSES x EVALUATION_CLASSES + 1 CV_32S, true digit per row, predicted per column
+    double p50Us = 0.0;
+    double p95Us = 0.0;
+    double p99Us = 0.0;
+    double samplesPerSecond = 0.0;
+    size_t modelBytes = 0;
+};
+
+EvaluationResult evaluateClassifier(const std::string& name, const DigitClassifier& classifier,
+                                    const cv::Mat& testSamples, const cv::Mat& testLabels);
+void printEvaluation(const EvaluationResult& result);
+bool writeEvaluations(const std::string& resultsFile, const std::vector<EvaluationResult>& results);
+bool compareEvaluations(const std::string& baselineFile, const std::vector<EvaluationResult>& results);
+bool evaluateDataBase(const std::string& dataBaseDirectory, const std::string& resultsFile,
+                      const std::string& baselineFile = std::string());
+
+#endif // EVALUATION_H
@@ -0,0 +1,15 @@
+#ifndef GRIDDIGITS_H
+#define GRIDDIGITS_H
+
+#include "opencv2/core.hpp"
+#include <vector>
+
+// Digits found by one connected component pass over the whole warped grid,
+// filled in by DetectGrid::findDigitComponents and read by recognizeGridDigits
+struct GridDigits
+{
+    cv::Mat ink;                                // the 450x450 grid without lines, blurred and thresholded like a cell, white digits on black
+    std::vector<cv::Rect> rects[9][9];          // [x][y], bounding boxes in grid coordinates of the digits of a cell, left to right
+};
+
+#endif // GRIDDIGITS_H
@@ -0,0 +1,266 @@
+#include "knnkernel.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KNN_KERNEL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KNN_TARGET_AVX2
+#define KNN_TARGET_POPCNT
+#else
+#define KNN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KNN_TARGET_POPCNT __attribute__((target("popcnt")))
+#endif
+#endif
+
+// train rows handled per block, 128 rows of 600 floats stay in L2 while every query runs over them
+static const int TRAIN_BLOCK_ROWS = 128;
+
+typedef float (*DistanceFn)(const float* a, const float* b, int dim);
+typedef int (*HammingFn)(const uint64_t* a, const uint64_t* b, int words);
+
+static float distanceScalar(const float* a, const float* b, int dim)
+{
+    float sum = 0;
+    for (int i = 0; i < dim; i++) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+#ifdef KNN_KERNEL_X86
+static float distanceSse2(const float* a, const float* b, int dim)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(d0, d0));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(d1, d1));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < dim; i++) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+KNN_TARGET_AVX2 static float distanceAvx2(const float* a, const float* b, int dim)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+    }
+    __m256 sum8 = _mm256_add_ps(sum0, sum1);
+    __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum4);
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < dim; i++) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+static bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6) return false;   // the OS has to save the ymm registers
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+KNN_TARGET_POPCNT static int hammingPopcnt(const uint64_t* a, const uint64_t* b, int words)
+{
+    int bits = 0;
+    for (int i = 0; i < words; i++) {
+#ifdef _MSC_VER
+        bits += int(__popcnt64(a[i] ^ b[i]));
+#else
+        bits += __builtin_popcountll(a[i] ^ b[i]);
+#endif
+    }
+    return bits;
+}
+
+static bool cpuHasPopcnt()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 23)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+#endif
+}
+#endif
+
+static int hammingScalar(const uint64_t* a, const uint64_t* b, int words)
+{
+    int bits = 0;
+    for (int i = 0; i < words; i++) {
+        uint64_t x = a[i] ^ b[i];
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        bits += int((x * 0x0101010101010101ULL) >> 56);
+    }
+    return bits;
+}
+
+bool knnKernelSupported(KnnKernel kernel)
+{
+    switch (kernel) {
+    case KNN_KERNEL_AUTO:
+    case KNN_KERNEL_SCALAR:
+        return true;
+#ifdef KNN_KERNEL_X86
+    case KNN_KERNEL_SSE2:
+        return true;
+    case KNN_KERNEL_AVX2:
+    {
+        static const bool hasAvx2 = cpuHasAvx2();
+        return hasAvx2;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+static KnnKernel resolveKernel(KnnKernel kernel)
+{
+    if (kernel != KNN_KERNEL_AUTO) return kernel;
+    if (knnKernelSupported(KNN_KERNEL_AVX2)) return KNN_KERNEL_AVX2;
+    if (knnKernelSupported(KNN_KERNEL_SSE2)) return KNN_KERNEL_SSE2;
+    return KNN_KERNEL_SCALAR;
+}
+
+const char* knnKernelName(KnnKernel kernel)
+{
+    switch (resolveKernel(kernel)) {
+    case KNN_KERNEL_SSE2: return "sse2";
+    case KNN_KERNEL_AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+static DistanceFn distanceFunction(KnnKernel kernel)
+{
+    kernel = resolveKernel(kernel);
+#ifdef KNN_KERNEL_X86
+    if (kernel == KNN_KERNEL_AVX2 && knnKernelSupported(KNN_KERNEL_AVX2)) return distanceAvx2;
+    if (kernel == KNN_KERNEL_SSE2) return distanceSse2;
+#endif
+    return distanceScalar;
+}
+
+//Function to put a candidate in the sorted top k list of one query if it is nearer than the current worst
+template<typename T>
+static inline void insertCandidate(int* idx, T* dist, int k, int candidate, T candidateDist)
+{
+    int i = k - 1;
+    while (i > 0 && dist[i - 1] > candidateDist) {
+        dist[i] = dist[i - 1];
+        idx[i] = idx[i - 1];
+        i--;
+    }
+    dist[i] = candidateDist;
+    idx[i] = candidate;
+}
+
+void nearestNeighbours(const float* queries, int queryCount, const float* train, int trainCount, int dim,
+                       int k, int* nearestIdx, float* nearestDist, KnnKernel kernel)
+{
+    DistanceFn distance = distanceFunction(kernel);
+
+    std::fill(nearestIdx, nearestIdx + size_t(queryCount) * k, -1);
+    std::fill(nearestDist, nearestDist + size_t(queryCount) * k, std::numeric_limits<float>::max());
+
+    for (int blockStart = 0; blockStart < trainCount; blockStart += TRAIN_BLOCK_ROWS) {
+        int blockEnd = std::min(blockStart + TRAIN_BLOCK_ROWS, trainCount);
+        for (int q = 0; q < queryCount; q++) {
+            const float* query = queries + size_t(q) * dim;
+            int* idx = nearestIdx + size_t(q) * k;
+            float* dist = nearestDist + size_t(q) * k;
+            for (int t = blockStart; t < blockEnd; t++) {
+                float d = distance(query, train + size_t(t) * dim, dim);
+                if (d < dist[k - 1]) {
+                    insertCandidate(idx, dist, k, t, d);
+                }
+            }
+        }
+    }
+}
+
+int binaryTemplateWords(int dim)
+{
+    return (dim + 63) / 64;
+}
+
+void packBinaryTemplates(const float* samples, int count, int dim, uint64_t* templates)
+{
+    int words = binaryTemplateWords(dim);
+    std::fill(templates, templates + size_t(count) * words, uint64_t(0));
+    for (int row = 0; row < count; row++) {
+        const float* sample = samples + size_t(row) * dim;
+        uint64_t* bits = templates + size_t(row) * words;
+        for (int i = 0; i < dim; i++) {
+            if (sample[i] >= 128) {
+                bits[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+    }
+}
+
+void hammingNearestNeighbours(const uint64_t* queries, int queryCount, const uint64_t* train, int trainCount, int words,
+                              int k, int* nearestIdx, int* nearestDist)
+{
+    HammingFn distance = hammingScalar;
+#ifdef KNN_KERNEL_X86
+    static const bool hasPopcnt = cpuHasPopcnt();
+    if (hasPopcnt) distance = hammingPopcnt;
+#endif
+
+    std::fill(nearestIdx, nearestIdx + size_t(queryCount) * k, -1);
+    std::fill(nearestDist, nearestDist + size_t(queryCount) * k, std::numeric_limits<int>::max());
+
+    for (int q = 0; q < queryCount; q++) {
+        const uint64_t* query = queries + size_t(q) * words;
+        int* idx = nearestIdx + size_t(q) * k;
+        int* dist = nearestDist + size_t(q) * k;
+        for (int t = 0; t < trainCount; t++) {
+            int d = distance(query, train + size_t(t) * words, words);
+            if (d < dist[k - 1]) {
+                insertCandidate(idx, dist, k, t, d);
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef KNNKERNEL_H
+#define KNNKERNEL_H
+
+#include <cstdint>
+
+// Brute-force k nearest neighbour search over squared euclidean distance.
+// The distance loop is written for SSE2 and AVX2+FMA, the best one the CPU
+// supports is picked at runtime; other CPUs use the scalar loop.
+enum KnnKernel {
+    KNN_KERNEL_AUTO,
+    KNN_KERNEL_SCALAR,
+    KNN_KERNEL_SSE2,
+    KNN_KERNEL_AVX2
+};
+
+bool knnKernelSupported(KnnKernel kernel);
+const char* knnKernelName(KnnKernel kernel);
+
+// For every one of the queryCount rows in queries, write the indices and squared distances of
+// its k nearest rows in train (sorted nearest first) to nearestIdx/nearestDist[query * k + i].
+// Rows are dim floats long and tightly packed. If trainCount < k the remaining slots get index -1.
+void nearestNeighbours(const float* queries, int queryCount, const float* train, int trainCount, int dim,
+                       int k, int* nearestIdx, float* nearestDist, KnnKernel kernel = KNN_KERNEL_AUTO);
+
+// Bit-packed templates: every value >= 128 becomes a 1 bit, a row of dim values takes
+// binaryTemplateWords(dim) 64 bit words. Rows are compared with XOR + popcount.
+int binaryTemplateWords(int dim);
+void packBinaryTemplates(const float* samples, int count, int dim, uint64_t* templates);
+
+// Same contract as nearestNeighbours, with the number of differing bits as distance.
+void hammingNearestNeighbours(const uint64_t* queries, int queryCount, const uint64_t* train, int trainCount, int words,
+                              int k, int* nearestIdx, int* nearestDist);
+
+#endif // KNNKERNEL_H
@@ -0,0 +1,337 @@
+#include "lshindex.h"
+#include "knnkernel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+static const char LSH_MAGIC[4] = {'L', 'S', 'H', 'I'};
+static const uint32_t LSH_VERSION = 1;
+static const int LSH_MAX_BITS = 20;
+
+static float dot(const float* a, const float* b, int dim)
+{
+    float sum = 0;
+    for (int i = 0; i < dim; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+//Function to build the index of count rows of dim floats, the random directions follow from seed
+std::vector<uint8_t> LshIndex::build(const float* samples, int count, int dim, int tables, int bits, uint32_t seed,
+                                     ThreadPool* pool)
+{
+    tables = std::max(1, tables);
+    bits = std::min(std::max(1, bits), LSH_MAX_BITS);
+    int planeCount = tables * bits;
+    size_t buckets = size_t(1) << bits;
+
+    LshIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LSH_MAGIC, sizeof(LSH_MAGIC));
+    header.version = LSH_VERSION;
+    header.tables = uint32_t(tables);
+    header.bits = uint32_t(bits);
+    header.dim = uint32_t(dim);
+    header.sampleCount = uint32_t(count);
+
+    size_t planesBytes = size_t(planeCount) * dim * sizeof(float);
+    size_t offsetsBytes = size_t(planeCount) * sizeof(float);
+    size_t startsBytes = size_t(tables) * (buckets + 1) * sizeof(uint32_t);
+    size_t rowsBytes = size_t(tables) * count * sizeof(uint32_t);
+    std::vector<uint8_t> data(sizeof(header) + planesBytes + offsetsBytes + startsBytes + rowsBytes);
+    memcpy(data.data(), &header, sizeof(header));
+    float* planes = reinterpret_cast<float*>(data.data() + sizeof(header));
+    float* offsets = reinterpret_cast<float*>(data.data() + sizeof(header) + planesBytes);
+    uint32_t* starts = reinterpret_cast<uint32_t*>(data.data() + sizeof(header) + planesBytes + offsetsBytes);
+    uint32_t* rows = reinterpret_cast<uint32_t*>(data.data() + sizeof(header) + planesBytes + offsetsBytes + startsBytes);
+
+    //random gaussian directions through the mean, so every bit splits the samples roughly in half
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    for (size_t i = 0; i < size_t(planeCount) * dim; i++) {
+        planes[i] = gaussian(rng);
+    }
+    std::vector<double> mean(size_t(dim), 0.0);
+    for (int row = 0; row < count; row++) {
+        for (int i = 0; i < dim; i++) mean[size_t(i)] += samples[size_t(row) * dim + i];
+    }
+    std::vector<float> meanFloat(static_cast<size_t>(dim));
+    for (int i = 0; i < dim; i++) meanFloat[size_t(i)] = count > 0 ? float(mean[size_t(i)] / count) : 0.0f;
+    for (int p = 0; p < planeCount; p++) {
+        offsets[p] = dot(meanFloat.data(), planes + size_t(p) * dim, dim);
+    }
+
+    //code of every row in every table, the expensive part, rows are independent
+    std::vector<uint32_t> codes(size_t(count) * tables);
+    auto hashRow = [&](int row) {
+        const float* sample = samples + size_t(row) * dim;
+        for (int t = 0; t < tables; t++) {
+            uint32_t code = 0;
+            for (int b = 0; b < bits; b++) {
+                int p = t * bits + b;
+                if (dot(sample, planes + size_t(p) * dim, dim) > offsets[p]) code |= uint32_t(1) << b;
+            }
+            codes[size_t(row) * tables + t] = code;
+        }
+    };
+    if (pool) {
+        pool->parallelFor(count, hashRow);
+    }
+    else {
+        for (int row = 0; row < count; row++) hashRow(row);
+    }
+
+    //counting sort of the rows by bucket, one table at a time
+    for (int t = 0; t < tables; t++) {
+        uint32_t* tableStarts = starts + size_t(t) * (buckets + 1);
+        uint32_t* tableRows = rows + size_t(t) * count;
+        std::fill(tableStarts, tableStarts + buckets + 1, uint32_t(0));
+        for (int row = 0; row < count; row++) tableStarts[codes[size_t(row) * tables + t] + 1]++;
+        for (size_t b = 0; b < buckets; b++) tableStarts[b + 1] += tableStarts[b];
+        std::vector<uint32_t> next(tableStarts, tableStarts + buckets);
+        for (int row = 0; row < count; row++) tableRows[next[codes[size_t(row) * tables + t]]++] = uint32_t(row);
+    }
+    return data;
+}
+
+//Function to use an index that is already in memory, the bytes have to stay valid while the index is used.
+//Every bucket start and row number is checked once here, so a damaged file can not send a search out of bounds.
+bool LshIndex::open(const uint8_t* data, size_t size)
+{
+    opened = false;
+    addedKeys.clear();
+    addedCount = 0;
+    if (!data || size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LSH_MAGIC, sizeof(LSH_MAGIC)) != 0 || header.version != LSH_VERSION
+            || header.tables == 0 || header.bits == 0 || header.bits > uint32_t(LSH_MAX_BITS) || header.dim == 0) {
+        return false;
+    }
+    uint64_t planeCount = uint64_t(header.tables) * header.bits;
+    uint64_t buckets = uint64_t(1) << header.bits;
+    uint64_t planesBytes = planeCount * header.dim * sizeof(float);
+    uint64_t offsetsBytes = planeCount * sizeof(float);
+    uint64_t startsBytes = uint64_t(header.tables) * (buckets + 1) * sizeof(uint32_t);
+    uint64_t rowsBytes = uint64_t(header.tables) * header.sampleCount * sizeof(uint32_t);
+    if (sizeof(header) + planesBytes + offsetsBytes + startsBytes + rowsBytes > size) {
+        return false;
+    }
+    planes = reinterpret_cast<const float*>(data + sizeof(header));
+    offsets = reinterpret_cast<const float*>(data + sizeof(header) + planesBytes);
+    bucketStarts = reinterpret_cast<const uint32_t*>(data + sizeof(header) + planesBytes + offsetsBytes);
+    rows = reinterpret_cast<const uint32_t*>(data + sizeof(header) + planesBytes + offsetsBytes + startsBytes);
+
+    //the buckets of a table run upwards within its sampleCount rows, and every row is one of the samples
+    for (uint32_t t = 0; t < header.tables; t++) {
+        const uint32_t* tableStarts = bucketStarts + size_t(t) * (buckets + 1);
+        for (uint64_t b = 0; b < buckets; b++) {
+            if (tableStarts[b] > tableStarts[b + 1]) {
+                return false;
+            }
+        }
+        if (tableStarts[buckets] > header.sampleCount) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < uint64_t(header.tables) * header.sampleCount; i++) {
+        if (rows[i] >= header.sampleCount) {
+            return false;
+        }
+    }
+    bytes = size_t(sizeof(header) + planesBytes + offsetsBytes + startsBytes + rowsBytes);
+    opened = true;
+    return true;
+}
+
+//Function to put rows that came after the index was built into its buckets, numbered after the rows already
+//in it. Only the buckets in memory grow, the bytes given to open() are never written.
+void LshIndex::add(const float* samples, int count)
+{
+    if (!opened || count <= 0) {
+        return;
+    }
+    addedKeys.resize(header.tables);
+    std::vector<uint32_t> codes(header.tables);
+    std::vector<float> margins(size_t(header.tables) * header.bits);
+    for (int row = 0; row < count; row++) {
+        hashQuery(samples + size_t(row) * header.dim, codes.data(), margins.data());
+        uint64_t number = uint64_t(header.sampleCount) + uint64_t(addedCount) + uint64_t(row);
+        for (uint32_t t = 0; t < header.tables; t++) {
+            addedKeys[t].push_back(uint64_t(codes[t]) << 32 | number);
+        }
+    }
+    addedCount += count;
+    for (std::vector<uint64_t>& keys : addedKeys) {
+        std::sort(keys.begin(), keys.end());
+    }
+}
+
+bool LshIndex::isOpen() const
+{
+    return opened;
+}
+
+int LshIndex::sampleCount() const
+{
+    return opened ? int(header.sampleCount) : 0;
+}
+
+int LshIndex::dim() const
+{
+    return opened ? int(header.dim) : 0;
+}
+
+int LshIndex::tables() const
+{
+    return opened ? int(header.tables) : 0;
+}
+
+int LshIndex::bits() const
+{
+    return opened ? int(header.bits) : 0;
+}
+
+size_t LshIndex::memoryUsage() const
+{
+    return opened ? bytes + size_t(addedCount) * header.tables * sizeof(uint64_t) : 0;
+}
+
+//Function to hash a query in every table, margins gets how far it is from every plane
+void LshIndex::hashQuery(const float* query, uint32_t* codes, float* margins) const
+{
+    int bits = int(header.bits);
+    for (int t = 0; t < int(header.tables); t++) {
+        uint32_t code = 0;
+        for (int b = 0; b < bits; b++) {
+            int p = t * bits + b;
+            float projection = dot(query, planes + size_t(p) * header.dim, int(header.dim)) - offsets[p];
+            if (projection > 0) code |= uint32_t(1) << b;
+            margins[p] = std::fabs(projection);
+        }
+        codes[t] = code;
+    }
+}
+
+//Function to collect the rows in the probed buckets of every table, each row once and in ascending order
+void LshIndex::candidates(const float* query, int probes, std::vector<int>& found) const
+{
+    int tables = int(header.tables);
+    int bits = int(header.bits);
+    size_t buckets = size_t(1) << bits;
+    std::vector<uint32_t> codes(static_cast<size_t>(tables));
+    std::vector<float> margins(size_t(tables) * bits);
+    hashQuery(query, codes.data(), margins.data());
+
+    //a stamp per row instead of clearing a seen flag for every query
+    size_t rowCount = size_t(header.sampleCount) + size_t(addedCount);
+    thread_local std::vector<uint32_t> stamps;
+    thread_local uint32_t stamp = 0;
+    if (stamps.size() < rowCount) {
+        stamps.assign(rowCount, 0);
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        stamp = 1;
+    }
+
+    found.clear();
+    std::vector<int> order(static_cast<size_t>(bits));
+    for (int t = 0; t < tables; t++) {
+        //probe 0 is the bucket of the query, probe i flips the bit with the i-th smallest margin
+        for (int b = 0; b < bits; b++) order[size_t(b)] = b;
+        const float* tableMargins = margins.data() + size_t(t) * bits;
+        int flips = std::min(probes - 1, bits);
+        if (flips > 0) {
+            std::partial_sort(order.begin(), order.begin() + flips, order.end(),
+                              [&](int a, int b) { return tableMargins[a] < tableMargins[b]; });
+        }
+        const uint32_t* tableStarts = bucketStarts + size_t(t) * (buckets + 1);
+        const uint32_t* tableRows = rows + size_t(t) * header.sampleCount;
+        for (int probe = 0; probe <= flips; probe++) {
+            uint32_t code = probe == 0 ? codes[size_t(t)] : codes[size_t(t)] ^ (uint32_t(1) << order[size_t(probe - 1)]);
+            for (uint32_t i = tableStarts[code]; i < tableStarts[code + 1]; i++) {
+                uint32_t row = tableRows[i];
+                if (stamps[row] != stamp) {
+                    stamps[row] = stamp;
+                    found.push_back(int(row));
+                }
+            }
+            if (addedCount == 0) {
+                continue;
+            }
+            const std::vector<uint64_t>& keys = addedKeys[size_t(t)];
+            for (auto key = std::lower_bound(keys.begin(), keys.end(), uint64_t(code) << 32);
+                    key != keys.end() && uint32_t(*key >> 32) == code; ++key) {
+                uint32_t row = uint32_t(*key);
+                if (stamps[row] != stamp) {
+                    stamps[row] = stamp;
+                    found.push_back(int(row));
+                }
+            }
+        }
+    }
+    std::sort(found.begin(), found.end());          // equal distances then keep the order of a full search
+}
+
+//Function with the contract of nearestNeighbours over the sampleCount indexed rows of samples: only the rows
+//in the probed buckets are measured. Probes 0, or a query with fewer than k candidates, searches every row.
+void LshIndex::search(const float* queries, int queryCount, const float* samples, int k, int probes,
+                      int* nearestIdx, float* nearestDist) const
+{
+    search(queries, queryCount, std::vector<LshBlock>(1, LshBlock{samples, int(header.sampleCount)}), k, probes, nearestIdx, nearestDist);
+}
+
+//Function to search the indexed rows and the added ones, the blocks hold them in their numbering one after the other
+void LshIndex::search(const float* queries, int queryCount, const std::vector<LshBlock>& blocks, int k, int probes,
+                      int* nearestIdx, float* nearestDist) const
+{
+    int dim = int(header.dim);
+    std::vector<int> found;
+    std::vector<float> gathered;
+    std::vector<int> blockStarts;
+    int count = 0;
+    for (const LshBlock& block : blocks) {
+        blockStarts.push_back(count);
+        count += block.rows;
+    }
+    //a row number to the row, the found rows are ascending so the block only moves forward
+    auto gatherRows = [&](const std::vector<int>& rowNumbers) {
+        gathered.resize(rowNumbers.size() * size_t(dim));
+        size_t b = 0;
+        for (size_t i = 0; i < rowNumbers.size(); i++) {
+            while (b + 1 < blocks.size() && rowNumbers[i] >= blockStarts[b + 1]) b++;
+            const float* row = blocks[b].samples + size_t(rowNumbers[i] - blockStarts[b]) * dim;
+            memcpy(gathered.data() + i * dim, row, size_t(dim) * sizeof(float));
+        }
+    };
+    if (blocks.size() == 1 && probes <= 0) {
+        nearestNeighbours(queries, queryCount, blocks[0].samples, count, dim, k, nearestIdx, nearestDist);
+        return;
+    }
+    for (int q = 0; q < queryCount; q++) {
+        const float* query = queries + size_t(q) * dim;
+        int* idx = nearestIdx + size_t(q) * k;
+        float* dist = nearestDist + size_t(q) * k;
+        if (probes > 0) {
+            candidates(query, probes, found);
+        }
+        if (probes <= 0 || int(found.size()) < k) {
+            if (blocks.size() == 1) {
+                nearestNeighbours(query, 1, blocks[0].samples, count, dim, k, idx, dist);
+                continue;
+            }
+            found.resize(size_t(count));
+            for (int row = 0; row < count; row++) found[size_t(row)] = row;
+        }
+        gatherRows(found);
+        nearestNeighbours(query, 1, gathered.data(), int(found.size()), dim, k, idx, dist);
+        for (int i = 0; i < k; i++) {
+            if (idx[i] >= 0) idx[i] = found[size_t(idx[i])];
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef LSHINDEX_H
+#define LSHINDEX_H
+
+#include "threadpool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int LSH_DEFAULT_TABLES = 8;
+const int LSH_DEFAULT_BITS = 12;            // 4096 buckets per table, a few dozen samples each at 100k samples
+const int LSH_MIN_SAMPLES = 20000;          // below this the brute force search is already fast enough
+const int LSH_DEFAULT_PROBES = 4;           // buckets looked at per table, the recall knob; 0 searches everything
+
+// Random projection LSH over the sample rows of a model. Every table hashes a row to
+// the signs of its projection on `bits` random directions through the sample mean,
+// rows with the same code share a bucket. A query only measures the rows in its own
+// bucket of every table and, for more probes, the buckets that differ in the bits it
+// was least sure about. The index is a flat block of bytes made to live in the index
+// section of a model file:
+//   LshIndexHeader
+//   float planes[tables * bits][dim]
+//   float offsets[tables * bits]               (projection of the sample mean on every plane)
+//   uint32 bucketStarts[tables][2^bits + 1]
+//   uint32 rows[tables][sampleCount]           (row numbers ordered by bucket)
+// Rows that came after the build, appended segments and corrections, are put into
+// buckets in memory with add() and numbered after the indexed ones.
+struct LshIndexHeader
+{
+    char magic[4];                  // "LSHI"
+    uint32_t version;
+    uint32_t tables;
+    uint32_t bits;
+    uint32_t dim;
+    uint32_t sampleCount;
+    uint32_t reserved[2];
+};
+
+// Consecutive rows of the searched samples, a model keeps its segments in separate blocks
+struct LshBlock
+{
+    const float* samples;
+    int rows;
+};
+
+class LshIndex
+{
+private:
+    LshIndexHeader header = {};
+    const float* planes = nullptr;          // views into the bytes given to open(), no copy
+    const float* offsets = nullptr;
+    const uint32_t* bucketStarts = nullptr;
+    const uint32_t* rows = nullptr;
+    std::vector<std::vector<uint64_t> > addedKeys;     // per table code << 32 | row of the rows given to add(), sorted
+    int addedCount = 0;
+    size_t bytes = 0;
+    bool opened = false;
+    void hashQuery(const float* query, uint32_t* codes, float* margins) const;
+    void candidates(const float* query, int probes, std::vector<int>& found) const;
+public:
+    static std::vector<uint8_t> build(const float* samples, int count, int dim, int tables = LSH_DEFAULT_TABLES,
+                                      int bits = LSH_DEFAULT_BITS, uint32_t seed = 1, ThreadPool* pool = nullptr);
+    bool open(const uint8_t* data, size_t size);
+    void add(const float* samples, int count);
+    bool isOpen() const;
+    int sampleCount() const;
+    int dim() const;
+    int tables() const;
+    int bits() const;
+    size_t memoryUsage() const;
+    void search(const float* queries, int queryCount, const float* samples, int k, int probes,
+                int* nearestIdx, float* nearestDist) const;
+    void search(const float* queries, int queryCount, const std::vector<LshBlock>& blocks, int k, int probes,
+                int* nearestIdx, float* nearestDist) const;
+};
+
+#endif // LSHINDEX_H
@@ -1,8 +1,114 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "digitdataset.h"
+#include "digitpack.h"
+#include "trainingprogram.h"
+#include "evaluation.h"
+#include "parametersweep.h"
 #include <QApplication>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
 
 int main(int argc, char *argv[])
 {
+    //headless benchmark: SudokuSolver --benchmark <image> [frames]
+    if (argc >= 3 && strcmp(argv[1], "--benchmark") == 0) {
+        benchmarkRecognition(argv[2], argc >= 4 ? atoi(argv[3]) : 10);
+        return 0;
+    }
+    //recognition with 1 to 16 threads: SudokuSolver --benchmark-threads <image> [frames]
+    if (argc >= 3 && strcmp(argv[1], "--benchmark-threads") == 0) {
+        benchmarkThreadScaling(argv[2], argc >= 4 ? atoi(argv[3]) : 10);
+        return 0;
+    }
+    //kernel microbenchmark: SudokuSolver --benchmark-knn
+    if (argc >= 2 && strcmp(argv[1], "--benchmark-knn") == 0) {
+        benchmarkNearestNeighbours();
+        return 0;
+    }
+    //classifier mode accuracy: SudokuSolver --compare-modes [digitDataBase]
+    if (argc >= 2 && strcmp(argv[1], "--compare-modes") == 0) {
+        compareClassifierModes(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR);
+        return 0;
+    }
+
+    //robustness gained by augmentation: SudokuSolver --compare-augmentation [digitDataBase] [variants]
+    if (argc >= 2 && strcmp(argv[1], "--compare-augmentation") == 0) {
+        compareAugmentation(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? atoi(argv[3]) : 10);
+        return 0;
+    }
+
+    //accuracy and throughput against pca dimensions: SudokuSolver --benchmark-pca [digitDataBase]
+    if (argc >= 2 && strcmp(argv[1], "--benchmark-pca") == 0) {
+        benchmarkPcaDimensions(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR);
+        return 0;
+    }
+    //accuracy and speed of every feature extractor: SudokuSolver --compare-features [digitDataBase]
+    if (argc >= 2 && strcmp(argv[1], "--compare-features") == 0) {
+        compareFeatureExtractors(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR);
+        return 0;
+    }
+    //quantised network against the knn: SudokuSolver --benchmark-net <digits.net> [digitDataBase]
+    if (argc >= 3 && strcmp(argv[1], "--benchmark-net") == 0) {
+        benchmarkDigitNet(argv[2], argc >= 4 ? argv[3] : DIGIT_DATABASE_DIR);
+        return 0;
+    }
+    //binary first stage with a float second stage for the unsure cells: SudokuSolver --compare-cascade [digitDataBase]
+    if (argc >= 2 && strcmp(argv[1], "--compare-cascade") == 0) {
+        compareCascade(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR);
+        return 0;
+    }
+    //recall against time per query of the neighbour index: SudokuSolver --benchmark-index [digitDataBase] [augmented variants per image]
+    if (argc >= 2 && strcmp(argv[1], "--benchmark-index") == 0) {
+        benchmarkIndex(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? atoi(argv[3]) : 50);
+        return 0;
+    }
+    //add a neighbour index to an existing model: SudokuSolver --index <model> [tables] [bits per table]
+    if (argc >= 3 && strcmp(argv[1], "--index") == 0) {
+        return indexModelFile(argv[2], argc >= 4 ? atoi(argv[3]) : LSH_DEFAULT_TABLES, argc >= 5 ? atoi(argv[4]) : LSH_DEFAULT_BITS) ? 0 : 1;
+    }
+    //accuracy, confusion and latency of every classifier mode: SudokuSolver --evaluate [digitDataBase] [results.json] [baseline.json]
+    if (argc >= 2 && strcmp(argv[1], "--evaluate") == 0) {
+        return evaluateDataBase(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? argv[3] : "evaluation.json",
+                                argc >= 5 ? argv[4] : "") ? 0 : 1;
+    }
+    //blur, threshold, resize and k grid with its pareto front: SudokuSolver --sweep [digitDataBase] [results.json]
+    if (argc >= 2 && strcmp(argv[1], "--sweep") == 0) {
+        return sweepDataBase(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? argv[3] : "sweep.json") ? 0 : 1;
+    }
+    //headless training: SudokuSolver --train [digitDataBase] [model] [pixels|zoning|hog] [pca components] [augmented variants per image]
+    if (argc >= 2 && strcmp(argv[1], "--train") == 0) {
+        FeatureType featureType = FEATURE_PIXELS;
+        if (argc >= 5 && !featureTypeFromName(argv[4], featureType)) {
+            std::cout << "error, unknown feature type " << argv[4] << "\n\n";
+            return 1;
+        }
+        AugmentOptions augment;
+        augment.variants = argc >= 7 ? atoi(argv[6]) : 0;
+        ThreadPool pool;
+        return trainDataBase(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? argv[3] : DIGIT_MODEL_FILE,
+                             featureType, argc >= 6 ? atoi(argv[5]) : 0, pool, augment) ? 0 : 1;
+    }
+    //add new labelled images to a model without retraining, too many appended segments are folded into one: SudokuSolver --append <model> <digit directory>
+    if (argc >= 4 && strcmp(argv[1], "--append") == 0) {
+        ThreadPool pool;
+        return appendDataBase(argv[3], argv[2], pool) ? 0 : 1;
+    }
+    //one mapped file instead of a tree of jpegs, every tool that takes a digitDataBase takes it: SudokuSolver --pack [digitDataBase] [pack file]
+    if (argc >= 2 && strcmp(argv[1], "--pack") == 0) {
+        ThreadPool pool;
+        return packDataBase(argc >= 3 ? argv[2] : DIGIT_DATABASE_DIR, argc >= 4 ? argv[3] : DIGIT_PACK_FILE, pool) ? 0 : 1;
+    }
+    //smallest training set within tolerance: SudokuSolver --condense <model> [tolerance %] [digitDataBase]
+    if (argc >= 3 && strcmp(argv[1], "--condense") == 0) {
+        return condenseDataBase(argc >= 5 ? argv[4] : DIGIT_DATABASE_DIR, argv[2], argc >= 4 ? atof(argv[3]) : 0.5) ? 0 : 1;
+    }
+    //reduce an existing model: SudokuSolver --pca <model> <projected model> <components>
+    if (argc >= 5 && strcmp(argv[1], "--pca") == 0) {
+        return projectModelFile(argv[2], argv[3], atoi(argv[4])) ? 0 : 1;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
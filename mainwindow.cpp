@@ -5,14 +5,27 @@
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
+#include <QTimer>
 #include <iostream>
 #include <sstream>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    corrections(DIGIT_MODEL_FILE, classifier)
 {
     ui->setupUi(this);
+
+    //a quantised network next to the model replaces the neighbour search, otherwise map the digit model once
+    if (!classifier.load(DIGIT_MODEL_FILE, DIGIT_NET_FILE)) {
+        ui->statusBar->showMessage(QString("Could not load the digit model!"),0);
+    }
+
+    //pick up retrained models without a restart
+    modelWatcher.addPath(DIGIT_MODEL_FILE);
+    modelWatcher.addPath(DIGIT_NET_FILE);
+    modelWatcher.addPath(TRAINING_IMAGES_FILE);
+    connect(&modelWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::modelFileChanged);
 }
 
 MainWindow::~MainWindow()
@@ -20,6 +33,105 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::on_pushButton_Reload_clicked()
+{
+    reloadModel();
+}
+
+//Function to react to a new model file, the reload or conversion waits a moment so a file that is still being
+//written is not read
+void MainWindow::modelFileChanged(const QString& path)
+{
+    if (path.toStdString() == TRAINING_IMAGES_FILE) {
+        xmlFileChanged = true;
+    }
+    else if (path.toStdString() != DIGIT_MODEL_FILE) {
+        otherFileChanged = true;
+    }
+    QTimer::singleShot(500, this, SLOT(modelFileSettled()));
+}
+
+//Function to reload after a file change, unless it was only our own append of corrections the classifier in use has already.
+//The correction writer thread loads the files, it tells apart its own appends by the model header it wrote.
+void MainWindow::modelFileSettled()
+{
+    if (xmlFileChanged) {
+        //new xml training files, convert them between two appends and load the result
+        xmlFileChanged = false;
+        otherFileChanged = false;
+        corrections.convertXml(CLASSIFICATIONS_FILE, TRAINING_IMAGES_FILE, DIGIT_NET_FILE, reloadDone());
+        return;
+    }
+    corrections.reload(DIGIT_NET_FILE, otherFileChanged, reloadDone());
+    otherFileChanged = false;
+}
+
+//Function to swap in the model files on disk, frames that are being recognised finish with the old model.
+//The corrections that are not in the file yet are learned again by the new model.
+void MainWindow::reloadModel()
+{
+    corrections.reload(DIGIT_NET_FILE, true, reloadDone());
+}
+
+//Function to hand the result of a reload on the correction writer thread back to the UI thread
+std::function<void(ModelReload)> MainWindow::reloadDone()
+{
+    return [this](ModelReload result) {
+        QMetaObject::invokeMethod(this, "modelReloaded", Qt::QueuedConnection, Q_ARG(int, int(result)));
+    };
+}
+
+//Function to show the result of a reload, the classifier is already swapped in
+void MainWindow::modelReloaded(int result)
+{
+    if (result == MODEL_RELOADED) {
+        cache.clear();          // the old entries can no longer be hit, free them
+        ui->statusBar->showMessage(QString("Digit model reloaded"),0);
+    }
+    else if (result == MODEL_RELOAD_FAILED) {
+        ui->statusBar->showMessage(QString("Could not reload the digit model, the old one is still used"),0);
+    }
+
+    //a model written with a rename is a new file, the watcher lost it
+    modelWatcher.addPath(DIGIT_MODEL_FILE);
+    modelWatcher.addPath(DIGIT_NET_FILE);
+    modelWatcher.addPath(TRAINING_IMAGES_FILE);
+}
+
+//Function to learn the digit the user typed in for a cell of the last frame: the cell goes into the classifier
+//in use at once, the model file gets it in the background
+void MainWindow::on_pushButton_Correct_clicked()
+{
+    int row = ui->spinBox_Row->value();
+    int col = ui->spinBox_Col->value();
+    int digit = ui->spinBox_Digit->value();
+    if (lastDigits.ink.empty()) {
+        ui->statusBar->showMessage(QString("No frame to correct yet"),0);
+        return;
+    }
+    std::shared_ptr<const DigitClassifier> model = classifier.acquire();
+    if (!model) {
+        ui->statusBar->showMessage(QString("No digit model loaded"),0);
+        return;
+    }
+
+    cv::Mat samples;
+    int digits = extractGridSamples(lastDigits, col, row, samples, model->featureType());      // [x][y] like the numbers
+    if (digits != 1) {
+        ui->statusBar->showMessage(QString("Cell %1,%2 holds %3 digits, only single digits can be corrected").arg(col).arg(row).arg(digits),0);
+        return;
+    }
+    cv::Mat labels(1, 1, CV_32S, cv::Scalar('0' + digit));
+    std::shared_ptr<const DigitClassifier> corrected = corrections.learn(labels, samples);
+    if (!corrected) {
+        ui->statusBar->showMessage(QString("The digit model in use can not learn corrections"),0);
+        return;
+    }
+    cache.clear();              // the new model id misses all old entries, free them
+    ui->statusBar->showMessage(QString("Cell %1,%2 learned as %3, %4 corrections in use").arg(col).arg(row).arg(digit)
+                               .arg(corrected->correctionCount()),0);
+}
+
 using namespace cv;
 using namespace std;
 
@@ -36,8 +148,9 @@ void MainWindow::on_pushButton_File_clicked()
         ui->statusBar->showMessage(QString("Could not open image!"),0);
     }
     else {
-        grid.splitGrid(src,splitSudoku);
-        imgArrayToIntArray(splitSudoku,numberArray);
+        std::shared_ptr<const DigitClassifier> model = classifier.acquire();
+        grid.splitGrid(src,splitSudoku,lastDigits);
+        if (model) gridDigitsToIntArray(lastDigits,numberArray,*model,&pool,&cache);
     }
 }
 
@@ -56,7 +169,6 @@ void MainWindow::on_pushButton_Webcam_clicked()
         Mat Cam;
         // Take first snapshot
         Img >> Cam;
-        int height = Cam.rows, width = Cam.cols;
         // there is no frame
         if (!Cam.data) {
             info.append(QString("Snapshot taken but could not be converted to image!"));
@@ -65,7 +177,7 @@ void MainWindow::on_pushButton_Webcam_clicked()
         else {
             for (int i=0;i<100;i++) {
                 // Create images
-                Mat src(width,height,CV_8UC1,1);
+                Mat src;
                 Mat foundGrid;
                 Mat splitSudoku[9][9];
                 int numberArray[9][9];
@@ -73,12 +185,13 @@ void MainWindow::on_pushButton_Webcam_clicked()
 
                 // Take snapshot
                 Img >> Cam;
-                // Convert to grayscale
+                // Convert to grayscale, the only colour conversion, the grid and its cells stay single channel
                 cvtColor(Cam,src,COLOR_BGR2GRAY);
 
                 imshow("camera", src);
-                grid.splitGrid(src,splitSudoku);
-                imgArrayToIntArray(splitSudoku,numberArray);
+                std::shared_ptr<const DigitClassifier> model = classifier.acquire();        // this frame keeps its model even if a reload happens
+                grid.splitGrid(src,splitSudoku,lastDigits);
+                if (model) gridDigitsToIntArray(lastDigits,numberArray,*model,&pool,&cache);
 
                 waitKey(300);
             }
@@ -2,9 +2,15 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QFileSystemWatcher>
 #include "opencv2/core.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/opencv.hpp"
+#include "classifierhandle.h"
+#include "threadpool.h"
+#include "recognitioncache.h"
+#include "correctionwriter.h"
+#include "griddigits.h"
 
 
 namespace Ui {
@@ -21,10 +27,25 @@ public:
 
 private:
    Ui::MainWindow *ui;
+   ClassifierHandle classifier;         // every frame takes a snapshot, a reload swaps in the new model
+   QFileSystemWatcher modelWatcher;     // reloads the model when the training program writes a new one
+   ThreadPool pool;                     // started once, recognises the cells of every frame in parallel
+   RecognitionCache cache;              // digits seen in earlier frames skip the neighbour search
+   CorrectionWriter corrections;        // appends corrected digits and reloads the model files off the UI thread
+   bool otherFileChanged = false;       // a change to a file the corrections are not written to, always reload
+   bool xmlFileChanged = false;         // new xml training files, convert them once they settled
+   GridDigits lastDigits;               // digits of the last frame, the ones a correction refers to
+   std::function<void(ModelReload)> reloadDone();
 
 private slots:
    void on_pushButton_Webcam_clicked();
    void on_pushButton_File_clicked();
+   void on_pushButton_Reload_clicked();
+   void on_pushButton_Correct_clicked();
+   void modelFileChanged(const QString& path);
+   void modelFileSettled();
+   void reloadModel();
+   void modelReloaded(int result);
 };
 
 #endif // MAINWINDOW_H
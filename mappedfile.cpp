@@ -0,0 +1,89 @@
+#include "mappedfile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mapping) UnmapViewOfFile(mapping);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapping) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+//Function to map a file into memory, a file shorter than minimumSize is not mapped
+bool MappedFile::open(const std::string& path, size_t minimumSize)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cout << "error, unable to open " << path << "\n\n";
+        return false;
+    }
+    fileHandle = file;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    mappingSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappingSize >= minimumSize && mappingSize > 0) {
+        mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle) mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        std::cout << "error, unable to open " << path << "\n\n";
+        return false;
+    }
+    struct stat fileStat;
+    fstat(file, &fileStat);
+    mappingSize = static_cast<size_t>(fileStat.st_size);
+    if (mappingSize >= minimumSize && mappingSize > 0) {
+        mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, file, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+    }
+    ::close(file);                      // the mapping stays valid after the descriptor is closed
+#endif
+
+    if (!mapping) {
+        std::cout << "error, unable to map " << path << "\n\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::isOpen() const
+{
+    return mapping != nullptr;
+}
+
+uint8_t* MappedFile::data() const
+{
+    return static_cast<uint8_t*>(mapping);
+}
+
+size_t MappedFile::size() const
+{
+    return mappingSize;
+}
@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A whole file mapped read-only into memory, for the file formats that hand out
+// Mat headers into their sections instead of reading them. Other processes may
+// still write, rename or delete the file while it is mapped.
+class MappedFile
+{
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool open(const std::string& path, size_t minimumSize);
+    void close();
+    bool isOpen() const;
+    uint8_t* data() const;              // the pages are read-only, it is not const only for the Mat headers
+    size_t size() const;
+};
+
+#endif // MAPPEDFILE_H
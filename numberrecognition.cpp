@@ -4,87 +4,46 @@
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <sstream>
 
-// global variables
-const int RESIZED_IMAGE_WIDTH = 20;
-const int RESIZED_IMAGE_HEIGHT = 30;
-
-
-int numberRecognition(Mat matTestingNumbers)
+//Function to smooth a grayscale cell before thresholding, a blur size below 3 leaves the cell as it is
+Mat blurCell(const Mat& matGrayscale, int blurSize)
 {
-    std::vector<ContourWithData> allContoursWithData;           // declare empty vectors,
-    std::vector<ContourWithData> validContoursWithData;         // we will fill these shortly
-
-    //===============read in training classifications===============
-
-    cv::Mat matClassificationInts;      // we will read the classification numbers into this variable as though it is a vector
-
-    cv::FileStorage fsClassifications("../SudokuSolver/classifications.xml", cv::FileStorage::READ);        // open the classifications file
-
-    if (fsClassifications.isOpened() == false) {                                                    // if the file was not opened successfully
-        std::cout << "error, unable to open training classifications file, exiting program\n\n";    // show error message
-        //return(0);                                                                                  // and exit program
+    if (blurSize < 3) {
+        return matGrayscale;
     }
-
-    fsClassifications["classifications"] >> matClassificationInts;      // read classifications section into Mat classifications variable
-    fsClassifications.release();                                        // close the classifications file
-
-    //===============read in training images===============
-
-    cv::Mat matTrainingImagesAsFlattenedFloats;         // we will read multiple images into this single image variable as though it is a vector
-
-    cv::FileStorage fsTrainingImages("../SudokuSolver/images.xml", cv::FileStorage::READ);          // open the training images file
-
-    if (fsTrainingImages.isOpened() == false) {                                                 // if the file was not opened successfully
-        std::cout << "error, unable to open training images file, exiting program\n\n";         // show error message
-        //return(0);                                                                              // and exit program
-    }
-
-    fsTrainingImages["images"] >> matTrainingImagesAsFlattenedFloats;           // read images section into Mat training images variable
-    fsTrainingImages.release();                                                 // close the traning images file
-
-    //===============train===============
-
-    cv::Ptr<cv::ml::KNearest>  kNearest(cv::ml::KNearest::create());            // instantiate the KNN object
-
-    // finally we get to the call to train, note that both parameters have to be of type Mat (a single Mat)
-    // even though in reality they are multiple images / numbers
-    kNearest->train(matTrainingImagesAsFlattenedFloats, cv::ml::ROW_SAMPLE, matClassificationInts);
-
-    //===============test===============
-    //Line below implemented in function
-    //cv::Mat matTestingNumbers = cv::imread(src);            // read in the test numbers image
-
-    if (matTestingNumbers.empty()) {                                // if unable to open image
-        std::cout << "error: image not read from file\n\n";         // show error message on command line
-        //return(0);                                                  // and exit program
-    }
-
-    cv::Mat matGrayscale;           //
-    cv::Mat matBlurred;             // declare more image variables
-    cv::Mat matThresh;              //
-    cv::Mat matThreshCopy;          //
-
-    cv::cvtColor(matTestingNumbers, matGrayscale, COLOR_BGR2GRAY);         // convert to grayscale
-
-    // blur
+    cv::Mat matBlurred;
     cv::GaussianBlur(matGrayscale,              // input image
                      matBlurred,                // output image
-                     cv::Size(5, 5),            // smoothing window width and height in pixels
+                     cv::Size(blurSize, blurSize),  // smoothing window width and height in pixels
                      0);                        // sigma value, determines how much the image will be blurred, zero makes function choose the sigma value
+    return matBlurred;
+}
 
-    // filter image from grayscale to black and white
+//Function to turn a smoothed cell into white digits on black
+Mat thresholdCell(const Mat& matBlurred, int thresholdBlock, double thresholdC)
+{
+    cv::Mat matThresh;
     cv::adaptiveThreshold(matBlurred,                           // input image
                           matThresh,                            // output image
                           255,                                  // make pixels that pass the threshold full white
                           cv::ADAPTIVE_THRESH_GAUSSIAN_C,       // use gaussian rather than mean, seems to give better results
                           cv::THRESH_BINARY_INV,                // invert so foreground will be white, background will be black
-                          11,                                   // size of a pixel neighborhood used to calculate threshold value
-                          2);                                   // constant subtracted from the mean or weighted mean
+                          thresholdBlock,                       // size of a pixel neighborhood used to calculate threshold value
+                          thresholdC);                          // constant subtracted from the mean or weighted mean
+    return matThresh;
+}
+
+//Function to find the bounding rects of the digits in a threshold cell, sorted left to right
+std::vector<cv::Rect> findDigitRects(const Mat& matThresh)
+{
+    std::vector<ContourWithData> allContoursWithData;           // declare empty vectors,
+    std::vector<ContourWithData> validContoursWithData;         // we will fill these shortly
 
-    matThreshCopy = matThresh.clone();              // make a copy of the thresh image, this in necessary b/c findContours modifies the image
+    cv::Mat matThreshCopy = matThresh.clone();              // make a copy of the thresh image, this in necessary b/c findContours modifies the image
 
     std::vector<std::vector<cv::Point> > ptContours;        // declare a vector for the contours
     std::vector<cv::Vec4i> v4iHierarchy;                    // declare a vector for the hierarchy (we won't use this in this program but this may be helpful for reference)
@@ -111,53 +70,293 @@ int numberRecognition(Mat matTestingNumbers)
     // sort contours from left to right
     std::sort(validContoursWithData.begin(), validContoursWithData.end(), ContourWithData::sortByBoundingRectXPosition);
 
-    std::string strFinalString;         // declare final string, this will have the final number sequence by the end of the program
+    std::vector<cv::Rect> digitRects;
+    for (size_t i = 0; i < validContoursWithData.size(); i++) {
+        digitRects.push_back(validContoursWithData[i].boundingRect);
+    }
+    return digitRects;
+}
+
+//Function to find the digits in one cell and append them, left to right, as feature rows to matSamples.
+//The cell is an 8 bit grayscale image with dark digits on a light background, as splitGrid cuts them;
+//it is only read, so several cells can be handled at the same time.
+int extractDigitSamples(const Mat& matTestingNumbers, Mat& matSamples, FeatureType featureType)
+{
+    //===============test===============
+    //Line below implemented in function
+    //cv::Mat matTestingNumbers = cv::imread(src);            // read in the test numbers image
+
+    if (matTestingNumbers.empty()) {                                // if unable to open image
+        std::cout << "error: image not read from file\n\n";         // show error message on command line
+        //return(0);                                                  // and exit program
+    }
 
-    for (size_t i = 0; i < validContoursWithData.size(); i++) {            // for each contour
+    cv::Mat matGrayscale = matTestingNumbers;       // the cells of splitGrid are already single channel
 
-        // draw a green rect around the current char
-        cv::rectangle(matTestingNumbers,                            // draw rectangle on original image
-                      validContoursWithData[i].boundingRect,        // rect to draw
-                      cv::Scalar(0, 255, 0),                        // green
-                      2);                                           // thickness
+    if (matTestingNumbers.channels() == 3) {
+        cv::cvtColor(matTestingNumbers, matGrayscale, COLOR_BGR2GRAY);     // colour cells from other callers
+    }
 
-        cv::Mat matROI = matThresh(validContoursWithData[i].boundingRect);          // get ROI image of bounding rect
+    // blur, then filter image from grayscale to black and white
+    cv::Mat matThresh = thresholdCell(blurCell(matGrayscale));
 
-        cv::Mat matROIResized;
-        cv::resize(matROI, matROIResized, cv::Size(RESIZED_IMAGE_WIDTH, RESIZED_IMAGE_HEIGHT));     // resize image, this will be more consistent for recognition and storage
+    std::vector<cv::Rect> digitRects = findDigitRects(matThresh);
 
-        cv::Mat matROIFloat;
-        matROIResized.convertTo(matROIFloat, CV_32FC1);             // convert Mat to float, necessary for call to find_nearest
+    for (size_t i = 0; i < digitRects.size(); i++) {            // for each digit
 
-        cv::Mat matROIFlattenedFloat = matROIFloat.reshape(1, 1);
+        cv::Mat matROI = matThresh(digitRects[i]);          // get ROI image of bounding rect
 
-        cv::Mat matCurrentChar(0, 0, CV_32F);
+        cv::Mat matROIFeatures = extractFeatures(matROI, featureType);     // the features the model was trained with
 
-        kNearest->findNearest(matROIFlattenedFloat, 5, matCurrentChar);     // finally we can call find_nearest !!!
+        matSamples.push_back(matROIFeatures);                       // one row per digit, classified later together with the other cells
+    }
+    return int(digitRects.size());
+}
 
-        float fltCurrentChar = static_cast<float>(matCurrentChar.at<float>(0, 0));
+//Function to turn the predictions of the digits found in one cell into the number they form, 0 if there are none
+static CellResult predictionsToCell(const DigitPrediction* predictions, int count)
+{
+    CellResult cell;
+    std::string strFinalString;         // declare final string, this will have the final number sequence by the end of the program
 
-        strFinalString = strFinalString + char(int(fltCurrentChar));        // append current char to full string
+    for (int i = 0; i < count; i++) {
+        strFinalString = strFinalString + char(predictions[i].labels[0]);      // append current char to full string
+        if (i == 0 || predictions[i].confidence < cell.confidence) {
+            cell.confidence = predictions[i].confidence;
+            for (int c = 0; c < DIGIT_CANDIDATES; c++) {
+                cell.candidates[c] = predictions[i].labels[c] ? predictions[i].labels[c] - '0' : 0;
+            }
+        }
     }
     if(strFinalString.empty())
     {
         strFinalString = "0";
     }
-    //cout << "\n\n" << "numbers read = " << strFinalString << endl;       // show the full string
-    //cv::imshow("matTestingNumbers", matTestingNumbers);     // show input image with green boxes drawn around found digits
-    return stoi(strFinalString);
+    cell.number = stoi(strFinalString);
+    cell.digits = count;
+    return cell;
 }
 
-void imgArrayToIntArray(Mat imgArray[9][9], int intArray[9][9])
+int numberRecognition(Mat matTestingNumbers, const DigitClassifier& classifier, RecognitionCache* cache)
+{
+    return recognizeCell(matTestingNumbers, classifier, cache).number;
+}
+
+//Function to run body(0 .. count - 1) on the pool, or on this thread when there is none
+static void forEachIndex(ThreadPool* pool, int count, const std::function<void(int)>& body)
+{
+    if (pool) {
+        pool->parallelFor(count, body);
+        return;
+    }
+    for (int index = 0; index < count; index++) {
+        body(index);
+    }
+}
+
+//Function to classify the feature rows, rows found in the cache skip the neighbour search and the others
+//are split in row ranges over the pool threads; returns the number of cache hits
+static int classifyRows(const DigitClassifier& classifier, const Mat& matSamples, std::vector<DigitPrediction>& predictions,
+                        ThreadPool* pool, RecognitionCache* cache)
+{
+    predictions.assign(size_t(matSamples.rows), DigitPrediction());
+    std::vector<uint64_t> keys;
+    std::vector<int> missRows;
+    Mat misses;
+    if (cache) {
+        keys.resize(size_t(matSamples.rows));
+        for (int row = 0; row < matSamples.rows; row++) {
+            keys[size_t(row)] = RecognitionCache::hashSample(matSamples.ptr<float>(row), matSamples.cols, classifier.modelId());
+            if (!cache->lookup(keys[size_t(row)], predictions[size_t(row)])) {
+                missRows.push_back(row);
+                misses.push_back(matSamples.row(row));
+            }
+        }
+    }
+    else {
+        misses = matSamples;
+        for (int row = 0; row < matSamples.rows; row++) missRows.push_back(row);
+    }
+
+    int chunks = pool ? std::max(1, std::min(pool->threadCount(), misses.rows)) : 1;
+    std::vector<std::vector<DigitPrediction> > chunkPredictions(static_cast<size_t>(chunks));
+    forEachIndex(pool, chunks, [&](int chunk) {
+        int firstRow = misses.rows * chunk / chunks;
+        int lastRow = misses.rows * (chunk + 1) / chunks;
+        classifier.classifyBatch(misses.rowRange(firstRow, lastRow), chunkPredictions[size_t(chunk)]);
+    });
+
+    size_t miss = 0;
+    for (const std::vector<DigitPrediction>& chunk : chunkPredictions) {
+        for (const DigitPrediction& prediction : chunk) {
+            size_t row = size_t(missRows[miss++]);
+            predictions[row] = prediction;
+            if (cache) cache->insert(keys[row], prediction);
+        }
+    }
+    return matSamples.rows - int(missRows.size());
+}
+
+//Function to read one cell with the runner up digits and the confidence of the classifier
+CellResult recognizeCell(Mat matTestingNumbers, const DigitClassifier& classifier, RecognitionCache* cache)
+{
+    Mat matSamples;
+    std::vector<DigitPrediction> predictions;
+
+    int count = extractDigitSamples(matTestingNumbers, matSamples, classifier.featureType());
+    classifyRows(classifier, matSamples, predictions, nullptr, cache);
+    return predictionsToCell(predictions.data(), count);
+}
+
+//Function to classify the feature rows of all cells in one search and turn them into the numbers of the grid,
+//shared by the per cell and the component pass extraction
+static void classifyCells(Mat cellSamples[9][9], const int sampleCount[9][9], int intArray[9][9], const DigitClassifier& classifier,
+                          const bool emptyCells[9][9], RecognitionStats* stats, CellResult cellResults[9][9], ThreadPool* pool,
+                          RecognitionCache* cache)
+{
+    Mat matSamples;
+    int firstSample[9][9];
+    int cellsSkipped = 0;
+    for(int y = 0; y < 9; y++)
+    {
+        for(int x = 0; x < 9; x++)
+        {
+            firstSample[x][y] = matSamples.rows;
+            if (emptyCells && emptyCells[x][y]) {
+                cellsSkipped++;
+            }
+            else if (sampleCount[x][y] > 0) {
+                matSamples.push_back(cellSamples[x][y]);
+            }
+        }
+    }
+
+    std::vector<DigitPrediction> predictions;
+    int cacheHits = classifyRows(classifier, matSamples, predictions, pool, cache);
+
+    for(int y = 0; y < 9; y++)
+    {
+        for(int x = 0; x < 9; x++)
+        {
+            CellResult cell = predictionsToCell(predictions.data() + firstSample[x][y], sampleCount[x][y]);
+            intArray[x][y] = cell.number;
+            if (cellResults) cellResults[x][y] = cell;
+        }
+    }
+
+    if (stats) {
+        stats->cellsSkipped = cellsSkipped;
+        stats->digitsClassified = matSamples.rows;
+        stats->cacheHits = cacheHits;
+        stats->secondStage = int(std::count_if(predictions.begin(), predictions.end(),
+                                               [](const DigitPrediction& prediction) { return prediction.stage == 2; }));
+    }
+}
+
+//Function to read the whole grid: the digits of all 81 cells are gathered in one N x 600 matrix
+//so the model is searched once per frame instead of once per digit, cells marked in emptyCells are skipped.
+//cellResults (optional) gets the candidates and confidence of every cell from the same search.
+//With a pool the cells are cut out in parallel and the search is split in row ranges over the threads;
+//the rows are always gathered in the same cell order, so the result does not depend on the thread count.
+//With a cache, digits seen before take their prediction from it instead of from the search.
+void recognizeGrid(Mat imgArray[9][9], int intArray[9][9], const DigitClassifier& classifier,
+                   const bool emptyCells[9][9], RecognitionStats* stats, CellResult cellResults[9][9], ThreadPool* pool,
+                   RecognitionCache* cache)
+{
+    Mat cellSamples[9][9];
+    int sampleCount[9][9];
+
+    forEachIndex(pool, 81, [&](int cell) {
+        int x = cell % 9;
+        int y = cell / 9;
+        sampleCount[x][y] = 0;
+        if (!emptyCells || !emptyCells[x][y]) {
+            sampleCount[x][y] = extractDigitSamples(imgArray[x][y], cellSamples[x][y], classifier.featureType());
+        }
+    });
+    classifyCells(cellSamples, sampleCount, intArray, classifier, emptyCells, stats, cellResults, pool, cache);
+}
+
+//Function to append the feature rows of the digits the component pass found in cell x,y, left to right
+int extractGridSamples(const GridDigits& digits, int x, int y, Mat& matSamples, FeatureType featureType)
+{
+    const std::vector<cv::Rect>& rects = digits.rects[x][y];
+    for (size_t i = 0; i < rects.size(); i++) {
+        matSamples.push_back(extractFeatures(digits.ink(rects[i]), featureType));
+    }
+    return int(rects.size());
+}
+
+//Function to read the whole grid like recognizeGrid, with the digit ROIs of findDigitComponents: the grid was
+//blurred and thresholded once, no findContours per cell, only the features of every digit are computed, in parallel with a pool.
+//Cells without a component are empty.
+void recognizeGridDigits(const GridDigits& digits, int intArray[9][9], const DigitClassifier& classifier,
+                         RecognitionStats* stats, CellResult cellResults[9][9], ThreadPool* pool, RecognitionCache* cache)
+{
+    Mat cellSamples[9][9];
+    int sampleCount[9][9];
+    bool emptyCells[9][9];
+
+    forEachIndex(pool, 81, [&](int cell) {
+        int x = cell % 9;
+        int y = cell / 9;
+        emptyCells[x][y] = digits.rects[x][y].empty();
+        sampleCount[x][y] = extractGridSamples(digits, x, y, cellSamples[x][y], classifier.featureType());
+    });
+    classifyCells(cellSamples, sampleCount, intArray, classifier, emptyCells, stats, cellResults, pool, cache);
+}
+
+//Function to print the grid and what is worth a second look in it
+static void printGrid(const int intArray[9][9], const RecognitionStats& stats, const CellResult cellResults[9][9],
+                      const RecognitionCache* cache)
 {
     for(int y = 0; y < 9; y++)
     {
         for(int x = 0; x < 9; x++)
         {
-            intArray[x][y] = numberRecognition(imgArray[x][y]);
             cout << intArray[x][y] << ",";
         }
         cout << endl;
     }
+    cout << "empty cells skipped: " << stats.cellsSkipped << ", digits classified: " << stats.digitsClassified
+         << ", second stage: " << stats.secondStage << endl;
+    if (cache) {
+        cout << "cache hits this frame: " << stats.cacheHits << ", hit rate: " << 100.0 * cache->hitRate() << " %, "
+             << cache->size() << " entries in " << cache->memoryUsage() << " bytes" << endl;
+    }
+
+    //the cells a later stage should look at again, with the digits the classifier hesitated between
+    for(int y = 0; y < 9; y++)
+    {
+        for(int x = 0; x < 9; x++)
+        {
+            const CellResult& cell = cellResults[x][y];
+            if (cell.digits > 0 && cell.confidence < LOW_CONFIDENCE) {
+                cout << "uncertain cell " << x << "," << y << ": " << cell.candidates[0];
+                for (int c = 1; c < DIGIT_CANDIDATES && cell.candidates[c]; c++) {
+                    cout << " or " << cell.candidates[c];
+                }
+                cout << " (confidence " << cell.confidence << ")" << endl;
+            }
+        }
+    }
     cout << endl;
 }
+
+void imgArrayToIntArray(Mat imgArray[9][9], int intArray[9][9], const DigitClassifier& classifier,
+                        const bool emptyCells[9][9], ThreadPool* pool, RecognitionCache* cache)
+{
+    RecognitionStats stats;
+    CellResult cellResults[9][9];
+    recognizeGrid(imgArray, intArray, classifier, emptyCells, &stats, cellResults, pool, cache);
+    printGrid(intArray, stats, cellResults, cache);
+}
+
+void gridDigitsToIntArray(const GridDigits& digits, int intArray[9][9], const DigitClassifier& classifier,
+                          ThreadPool* pool, RecognitionCache* cache)
+{
+    RecognitionStats stats;
+    CellResult cellResults[9][9];
+    recognizeGridDigits(digits, intArray, classifier, &stats, cellResults, pool, cache);
+    printGrid(intArray, stats, cellResults, cache);
+}
@@ -4,6 +4,10 @@
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
+#include "digitclassifier.h"
+#include "threadpool.h"
+#include "recognitioncache.h"
+#include "griddigits.h"
 #include <iostream>
 #include <sstream>
 
@@ -11,6 +15,9 @@ using namespace cv;
 using namespace std;
 
 const int MIN_CONTOUR_AREA = 100;
+const int CELL_BLUR_SIZE = 5;               // GaussianBlur window of the cells, below 3 is no blur
+const int CELL_THRESHOLD_BLOCK = 11;        // adaptiveThreshold neighbourhood of the cells, odd
+const double CELL_THRESHOLD_C = 2;          // adaptiveThreshold constant of the cells
 
 class ContourWithData {
 public:
@@ -30,6 +37,40 @@ public:
 
 };
 
-int numberRecognition(Mat matTestingNumbers);
-void imgArrayToIntArray(Mat imgArray[9][9], int intArray[9][9]);
+// counters filled in by recognizeGrid for the instrumentation
+struct RecognitionStats {
+    int cellsSkipped = 0;                       // cells marked empty before any contour analysis
+    int digitsClassified = 0;                   // rows sent to the classifier
+    int cacheHits = 0;                          // of those, rows answered by the cache without a search
+    int secondStage = 0;                        // of those, rows the second stage of a cascade decided
+};
+
+const float LOW_CONFIDENCE = 0.6f;             // cells below this are reported as worth a second look
+
+// Result for one grid cell. A cell can hold several digits, the candidates and
+// confidence are those of its least certain digit.
+struct CellResult {
+    int number = 0;                             // what numberRecognition returns, 0 for an empty cell
+    int digits = 0;                             // digits found in the cell
+    int candidates[DIGIT_CANDIDATES] = {};      // best digit value first, then the runner ups, 0 where there are none
+    float confidence = 1.0f;                    // confidence of the least certain digit, 1 for an empty cell
+};
+
+Mat blurCell(const Mat& matGrayscale, int blurSize = CELL_BLUR_SIZE);
+Mat thresholdCell(const Mat& matBlurred, int thresholdBlock = CELL_THRESHOLD_BLOCK, double thresholdC = CELL_THRESHOLD_C);
+std::vector<cv::Rect> findDigitRects(const Mat& matThresh);
+int extractDigitSamples(const Mat& matTestingNumbers, Mat& matSamples, FeatureType featureType);
+int numberRecognition(Mat matTestingNumbers, const DigitClassifier& classifier, RecognitionCache* cache = nullptr);
+CellResult recognizeCell(Mat matTestingNumbers, const DigitClassifier& classifier, RecognitionCache* cache = nullptr);
+void recognizeGrid(Mat imgArray[9][9], int intArray[9][9], const DigitClassifier& classifier,
+                   const bool emptyCells[9][9] = nullptr, RecognitionStats* stats = nullptr,
+                   CellResult cellResults[9][9] = nullptr, ThreadPool* pool = nullptr, RecognitionCache* cache = nullptr);
+int extractGridSamples(const GridDigits& digits, int x, int y, Mat& matSamples, FeatureType featureType);
+void recognizeGridDigits(const GridDigits& digits, int intArray[9][9], const DigitClassifier& classifier,
+                         RecognitionStats* stats = nullptr, CellResult cellResults[9][9] = nullptr, ThreadPool* pool = nullptr,
+                         RecognitionCache* cache = nullptr);
+void imgArrayToIntArray(Mat imgArray[9][9], int intArray[9][9], const DigitClassifier& classifier,
+                        const bool emptyCells[9][9] = nullptr, ThreadPool* pool = nullptr, RecognitionCache* cache = nullptr);
+void gridDigitsToIntArray(const GridDigits& digits, int intArray[9][9], const DigitClassifier& classifier,
+                          ThreadPool* pool = nullptr, RecognitionCache* cache = nullptr);
 #endif // NUMBERRECOGNITION_H
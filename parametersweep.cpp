@@ -0,0 +1,244 @@
+#include "parametersweep.h"
+#include "numberrecognition.h"
+#include "detectgrid.h"
+#include "digitclassifier.h"
+#include "digitdataset.h"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+const int SWEEP_DIGIT_HEIGHT = 30;          // height of a digit in a 50x50 cell of a warped grid
+
+const int SWEEP_BLUR_SIZES[] = {0, 3, 5, 7};
+const int SWEEP_THRESHOLD_BLOCKS[] = {7, 11, 15};
+const double SWEEP_THRESHOLD_CS[] = {2, 5};
+const cv::Size SWEEP_SIZES[] = {cv::Size(10, 15), cv::Size(16, 24), cv::Size(20, 30)};
+const int SWEEP_NEIGHBOURS[] = {1, 3, 5, 7};
+
+//Function to put a threshold digit from the database in the middle of a light cell, dark like splitGrid cuts them
+static Mat digitToCell(const Mat& digit)
+{
+    Mat cell(CELL_SIZE, CELL_SIZE, CV_8UC1, Scalar(255));
+    int height = SWEEP_DIGIT_HEIGHT;
+    int width = std::min(CELL_SIZE - 4, std::max(1, int(double(digit.cols) * height / digit.rows + 0.5)));
+    Mat resized;
+    cv::resize(digit, resized, Size(width, height));            // linear interpolation leaves grey edges like a camera does
+    Mat dark;
+    bitwise_not(resized, dark);
+    dark.copyTo(cell(Rect((CELL_SIZE - width) / 2, (CELL_SIZE - height) / 2, width, height)));
+    return cell;
+}
+
+//Function to flatten a digit resized to size, the pixel features for sizes other than the model's 20x30
+static Mat resizedPixels(const Mat& matROI, const cv::Size& size)
+{
+    Mat matROIResized;
+    cv::resize(matROI, matROIResized, size);
+    Mat matROIFloat;
+    matROIResized.convertTo(matROIFloat, CV_32FC1);
+    return matROIFloat.reshape(1, 1);
+}
+
+//Function to mark the configurations that no other one beats on both accuracy and time per cell
+void markParetoFront(std::vector<SweepResult>& results)
+{
+    std::vector<size_t> order(results.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (results[a].cellUs != results[b].cellUs) return results[a].cellUs < results[b].cellUs;
+        return results[a].accuracy > results[b].accuracy;
+    });
+    double bestAccuracy = -1.0;
+    for (size_t i : order) {
+        results[i].pareto = results[i].accuracy > bestAccuracy;        // faster ones came first, so it has to be more accurate
+        bestAccuracy = std::max(bestAccuracy, results[i].accuracy);
+    }
+}
+
+//Function to run every combination of blur, threshold, resize and k of the cell recognition over a labelled
+//digit tree. Each database digit is drawn into a cell, every fourth cell is a test cell, the others train the
+//classifier of the same configuration. The stages are nested so every blurred, thresholded and resized set of
+//cells is computed once and shared by all configurations that start with the same parameters; each stage runs
+//over the cells in parallel. The time per cell of a configuration is the sum of its stage times per test cell.
+std::vector<SweepResult> sweepRecognitionParameters(const std::string& dataBaseDirectory, ThreadPool& pool)
+{
+    std::vector<SweepResult> results;
+    Mat labels;
+    std::vector<Mat> digits;
+    if (!loadDigitImages(dataBaseDirectory, labels, digits, &pool)) {
+        return results;
+    }
+    int cellCount = int(digits.size());
+    std::vector<Mat> cells(digits.size());
+    pool.parallelFor(cellCount, [&](int i) { cells[size_t(i)] = digitToCell(digits[size_t(i)]); });
+
+    std::vector<int> testCells;
+    std::vector<int> trainCells;
+    for (int i = 0; i < cellCount; i++) {
+        (i % 4 == 3 ? testCells : trainCells).push_back(i);        // the split of splitTrainTest
+    }
+
+    std::vector<Mat> blurred(cells.size());
+    std::vector<Mat> thresholded(cells.size());
+    std::vector<Rect> digitRects(cells.size());                 // the largest digit of every cell
+    std::vector<int> digitCounts(cells.size());
+    std::vector<double> blurUs(cells.size());
+    std::vector<double> thresholdUs(cells.size());
+    std::vector<double> resizeUs(cells.size());
+    std::vector<double> classifyUs(testCells.size());
+    std::vector<int> intChars(testCells.size());
+    int stagesComputed = 0;
+
+    for (int blurSize : SWEEP_BLUR_SIZES)
+    {
+        pool.parallelFor(cellCount, [&](int i) {
+            TickMeter timer;
+            timer.start();
+            blurred[size_t(i)] = blurCell(cells[size_t(i)], blurSize);
+            timer.stop();
+            blurUs[size_t(i)] = timer.getTimeMicro();
+        });
+        stagesComputed++;
+
+        for (int thresholdBlock : SWEEP_THRESHOLD_BLOCKS)
+        for (double thresholdC : SWEEP_THRESHOLD_CS)
+        {
+            pool.parallelFor(cellCount, [&](int i) {
+                TickMeter timer;
+                timer.start();
+                thresholded[size_t(i)] = thresholdCell(blurred[size_t(i)], thresholdBlock, thresholdC);
+                std::vector<Rect> rects = findDigitRects(thresholded[size_t(i)]);
+                timer.stop();
+                thresholdUs[size_t(i)] = timer.getTimeMicro();
+                digitCounts[size_t(i)] = int(rects.size());
+                digitRects[size_t(i)] = Rect();
+                for (const Rect& rect : rects) {
+                    if (rect.area() > digitRects[size_t(i)].area()) digitRects[size_t(i)] = rect;
+                }
+            });
+            stagesComputed++;
+
+            for (const cv::Size& size : SWEEP_SIZES)
+            {
+                Mat features = Mat::zeros(cellCount, size.area(), CV_32F);
+                pool.parallelFor(cellCount, [&](int i) {
+                    if (digitCounts[size_t(i)] == 0) return;
+                    TickMeter timer;
+                    timer.start();
+                    resizedPixels(thresholded[size_t(i)](digitRects[size_t(i)]), size).copyTo(features.row(i));
+                    timer.stop();
+                    resizeUs[size_t(i)] = timer.getTimeMicro();
+                });
+                stagesComputed++;
+
+                DigitModelContents contents;
+                for (int i : trainCells) {
+                    if (digitCounts[size_t(i)] == 0) continue;
+                    contents.labels.push_back(labels.row(i));
+                    contents.samples.push_back(features.row(i));
+                }
+                if (contents.samples.rows == 0) continue;
+
+                for (int k : SWEEP_NEIGHBOURS)
+                {
+                    DigitClassifier classifier;
+                    if (!classifier.create(contents, CLASSIFIER_FLOAT, k)) continue;
+                    pool.parallelFor(int(testCells.size()), [&](int t) {
+                        int i = testCells[size_t(t)];
+                        intChars[size_t(t)] = 0;
+                        classifyUs[size_t(t)] = 0.0;
+                        if (digitCounts[size_t(i)] == 0) return;
+                        TickMeter timer;
+                        timer.start();
+                        intChars[size_t(t)] = classifier.classify(features.row(i));
+                        timer.stop();
+                        classifyUs[size_t(t)] = timer.getTimeMicro();
+                    });
+
+                    SweepResult result;
+                    result.blurSize = blurSize;
+                    result.thresholdBlock = thresholdBlock;
+                    result.thresholdC = thresholdC;
+                    result.width = size.width;
+                    result.height = size.height;
+                    result.k = k;
+                    int correct = 0;
+                    double totalUs = 0.0;
+                    for (size_t t = 0; t < testCells.size(); t++) {
+                        size_t i = size_t(testCells[t]);
+                        bool oneDigit = digitCounts[i] == 1;            // a split or lost digit reads as a wrong number
+                        if (oneDigit && intChars[t] == labels.at<int>(int(i))) correct++;
+                        totalUs += blurUs[i] + thresholdUs[i] + (digitCounts[i] > 0 ? resizeUs[i] : 0.0) + classifyUs[t];
+                    }
+                    result.accuracy = testCells.empty() ? 0.0 : 100.0 * correct / double(testCells.size());
+                    result.cellUs = testCells.empty() ? 0.0 : totalUs / double(testCells.size());
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    markParetoFront(results);
+    std::cout << results.size() << " configurations on " << testCells.size() << " test cells and " << trainCells.size()
+              << " training cells, " << pool.threadCount() << " threads, " << stagesComputed << " preprocessing passes instead of "
+              << 3 * results.size() << " without sharing prefixes\n\n";
+    return results;
+}
+
+//Function to store every configuration with its scores, the format follows the extension (.json, .yml or .xml)
+bool writeSweepResults(const std::string& resultsFile, const std::vector<SweepResult>& results)
+{
+    FileStorage fs(resultsFile, FileStorage::WRITE);
+    if (fs.isOpened() == false) {
+        std::cout << "error, unable to open results file " << resultsFile << " for writing\n\n";
+        return false;
+    }
+    fs << "configurations" << "[";
+    for (const SweepResult& result : results) {
+        fs << "{";
+        fs << "blur" << result.blurSize;
+        fs << "threshold_block" << result.thresholdBlock;
+        fs << "threshold_c" << result.thresholdC;
+        fs << "width" << result.width;
+        fs << "height" << result.height;
+        fs << "k" << result.k;
+        fs << "accuracy" << result.accuracy;
+        fs << "cell_us" << result.cellUs;
+        fs << "pareto" << int(result.pareto);
+        fs << "}";
+    }
+    fs << "]";
+    fs.release();
+    return true;
+}
+
+//Function to sweep the recognition parameters on all cores, print the Pareto front from fastest to most accurate
+//and write every configuration to resultsFile
+bool sweepDataBase(const std::string& dataBaseDirectory, const std::string& resultsFile)
+{
+    ThreadPool pool;
+    std::vector<SweepResult> results = sweepRecognitionParameters(dataBaseDirectory, pool);
+    if (results.empty()) {
+        return false;
+    }
+
+    std::vector<SweepResult> front;
+    for (const SweepResult& result : results) {
+        if (result.pareto) front.push_back(result);
+    }
+    std::sort(front.begin(), front.end(), [](const SweepResult& a, const SweepResult& b) { return a.cellUs < b.cellUs; });
+    std::cout << "pareto front, accuracy against time per cell:\n";
+    for (const SweepResult& result : front) {
+        std::cout << "blur " << result.blurSize << ", threshold " << result.thresholdBlock << "/" << result.thresholdC
+                  << ", resize " << result.width << "x" << result.height << ", k " << result.k << ": accuracy "
+                  << result.accuracy << " %, " << result.cellUs << " us per cell\n";
+    }
+    std::cout << "current: blur " << CELL_BLUR_SIZE << ", threshold " << CELL_THRESHOLD_BLOCK << "/" << CELL_THRESHOLD_C
+              << ", resize " << RESIZED_IMAGE_WIDTH << "x" << RESIZED_IMAGE_HEIGHT << ", k " << DEFAULT_NEIGHBOURS << "\n\n";
+
+    bool written = writeSweepResults(resultsFile, results);
+    if (written) {
+        std::cout << "results written to " << resultsFile << "\n\n";
+    }
+    return written;
+}
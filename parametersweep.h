@@ -0,0 +1,27 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include "threadpool.h"
+#include <string>
+#include <vector>
+
+// One point of the recognition parameter grid with what it scored on the corpus.
+struct SweepResult
+{
+    int blurSize = 0;               // GaussianBlur window, below 3 is no blur
+    int thresholdBlock = 0;         // adaptiveThreshold neighbourhood
+    double thresholdC = 0.0;        // adaptiveThreshold constant
+    int width = 0;                  // size the digit is resized to before the neighbour search
+    int height = 0;
+    int k = 0;                      // neighbours in the vote
+    double accuracy = 0.0;          // percent of the test cells read as exactly their digit
+    double cellUs = 0.0;            // mean time per test cell from the grayscale cell to the label
+    bool pareto = false;            // no other configuration is both more accurate and faster
+};
+
+std::vector<SweepResult> sweepRecognitionParameters(const std::string& dataBaseDirectory, ThreadPool& pool);
+void markParetoFront(std::vector<SweepResult>& results);
+bool writeSweepResults(const std::string& resultsFile, const std::vector<SweepResult>& results);
+bool sweepDataBase(const std::string& dataBaseDirectory, const std::string& resultsFile);
+
+#endif // PARAMETERSWEEP_H
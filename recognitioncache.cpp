@@ -0,0 +1,105 @@
+#include "recognitioncache.h"
+#include <cstring>
+
+RecognitionCache::RecognitionCache(size_t maxEntries) : capacity(maxEntries > 0 ? maxEntries : 1)
+{
+}
+
+//Function to hash a feature row 8 bytes at a time, multiply and fold like the splitmix64 finaliser
+uint64_t RecognitionCache::hashSample(const float* row, int length, uint64_t modelId)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(row);
+    size_t byteCount = size_t(length) * sizeof(float);
+    uint64_t hash = (0x9E3779B97F4A7C15ull ^ byteCount) + modelId * 0xD6E8FEB86659FD93ull;
+    size_t i = 0;
+    for (; i + 8 <= byteCount; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 31;
+    }
+    if (i < byteCount) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, byteCount - i);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+    }
+    hash ^= hash >> 30;
+    hash *= 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+//Function to get the cached prediction of a row, a hit makes the entry the most recently used one
+bool RecognitionCache::lookup(uint64_t key, DigitPrediction& prediction)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        missCount++;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, found->second);
+    prediction = found->second->second;
+    hitCount++;
+    return true;
+}
+
+//Function to store a prediction, the least recently used entry makes room when the cache is full
+void RecognitionCache::insert(uint64_t key, const DigitPrediction& prediction)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->second = prediction;
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, prediction);
+    index[key] = entries.begin();
+}
+
+void RecognitionCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    hitCount = 0;
+    missCount = 0;
+}
+
+size_t RecognitionCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+uint64_t RecognitionCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+uint64_t RecognitionCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
+
+double RecognitionCache::hitRate() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t lookups = hitCount + missCount;
+    return lookups > 0 ? double(hitCount) / double(lookups) : 0.0;
+}
+
+//Function to estimate the heap use: a list node and a hash map node per entry plus the bucket array
+size_t RecognitionCache::memoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t listNode = sizeof(Entry) + 2 * sizeof(void*);
+    size_t mapNode = sizeof(std::pair<const uint64_t, std::list<Entry>::iterator>) + sizeof(void*) + sizeof(size_t);
+    return entries.size() * (listNode + mapNode) + index.bucket_count() * sizeof(void*);
+}
@@ -0,0 +1,42 @@
+#ifndef RECOGNITIONCACHE_H
+#define RECOGNITIONCACHE_H
+
+#include "digitclassifier.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+const size_t DEFAULT_CACHE_ENTRIES = 4096;
+
+// Bounded LRU cache from the feature row of a digit to its prediction. Scans of the
+// same puzzle books print the same digits over and over, a hit skips the neighbour
+// search. The key is a 64 bit hash of the row and the id of the model that classified
+// it, the row itself is not stored, so an entry costs about a hundred bytes. Entries
+// of a replaced model are never hit again and age out, clear() frees them at once.
+// All functions lock, the cache can be shared by the recognition threads.
+class RecognitionCache
+{
+private:
+    typedef std::pair<uint64_t, DigitPrediction> Entry;
+    size_t capacity;
+    std::list<Entry> entries;                                           // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    mutable std::mutex mutex;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+public:
+    explicit RecognitionCache(size_t maxEntries = DEFAULT_CACHE_ENTRIES);
+    static uint64_t hashSample(const float* row, int length, uint64_t modelId = 0);
+    bool lookup(uint64_t key, DigitPrediction& prediction);
+    void insert(uint64_t key, const DigitPrediction& prediction);
+    void clear();
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    double hitRate() const;
+    size_t memoryUsage() const;
+};
+
+#endif // RECOGNITIONCACHE_H
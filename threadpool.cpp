@@ -0,0 +1,105 @@
+#include "threadpool.h"
+#include <algorithm>
+
+//Function to get the number of hardware threads, at least 1
+int defaultThreadCount()
+{
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+ThreadPool::ThreadPool(int threads) : nextIndex(0)
+{
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::threadCount() const
+{
+    return int(workers.size()) + 1;
+}
+
+//Function to take indices until the loop is exhausted, shared by the workers and the calling thread. The first
+//exception of a loop is kept for parallelFor to rethrow and stops the indices that were not handed out yet.
+void ThreadPool::runIndices()
+{
+    try {
+        for (int index = nextIndex.fetch_add(1); index < count; index = nextIndex.fetch_add(1)) {
+            (*body)(index);
+        }
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!loopException) {
+            loopException = std::current_exception();
+        }
+        nextIndex = count;
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    unsigned seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        workReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+        if (stopping) {
+            return;
+        }
+        seenGeneration = generation;
+        lock.unlock();
+        runIndices();
+        lock.lock();
+        if (--busyWorkers == 0) {
+            workDone.notify_one();
+        }
+    }
+}
+
+//Function to call loopBody(i) for every i in 0 .. indexCount - 1 on the pool and wait until all calls returned.
+//The order of the calls is not fixed, so loopBody should only write to the results of its own index.
+//If a call throws, the loop stops early and the first exception is rethrown here once every thread let go of loopBody.
+void ThreadPool::parallelFor(int indexCount, const std::function<void(int)>& loopBody)
+{
+    if (workers.empty() || indexCount <= 1) {
+        for (int index = 0; index < indexCount; index++) {
+            loopBody(index);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(callMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        body = &loopBody;
+        count = indexCount;
+        nextIndex = 0;
+        busyWorkers = int(workers.size());
+        generation++;
+    }
+    workReady.notify_all();
+    runIndices();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&] { return busyWorkers == 0; });
+    body = nullptr;
+    std::exception_ptr exception = loopException;
+    loopException = nullptr;
+    lock.unlock();
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+int defaultThreadCount();
+
+// Fixed size pool for data parallel loops. The workers are started once in the
+// constructor and sleep between loops, so a frame pays no thread start up.
+// parallelFor hands out the indices one at a time and the calling thread works
+// along, a pool of n threads has n - 1 workers and a pool of 1 runs inline.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex callMutex;                               // one parallelFor at a time
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    const std::function<void(int)>* body = nullptr;
+    int count = 0;
+    std::atomic<int> nextIndex;
+    int busyWorkers = 0;
+    unsigned generation = 0;                            // bumped for every loop, wakes the workers
+    bool stopping = false;
+    std::exception_ptr loopException;                   // first exception thrown by the loop body
+    void workerLoop();
+    void runIndices();
+public:
+    explicit ThreadPool(int threads = defaultThreadCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    int threadCount() const;
+    void parallelFor(int indexCount, const std::function<void(int)>& loopBody);
+};
+
+#endif // THREADPOOL_H
@@ -1,25 +1,436 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "trainingprogram.h"
+#include "digitclassifier.h"
+#include "digitmodel.h"
+#include "digitdataset.h"
+#include "digitpack.h"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
 #include <dirent.h>
+#include <set>
 #include <vector>
 
 //============================= global variables ===================================
 const int MIN_CONTOUR_AREA = 50;
 
-const int RESIZED_IMAGE_WIDTH = 20;
-const int RESIZED_IMAGE_HEIGHT = 30;
-
 //==================================================================================
 using namespace cv;
 using namespace std;
-void trainingNumbers() {
+//Function to fit a PCA projection to N x 600 samples and project them to N x components
+void fitProjection(const cv::Mat& samples, int components, cv::Mat& mean, cv::Mat& vectors, cv::Mat& projectedSamples)
+{
+    cv::PCA pca(samples, cv::Mat(), cv::PCA::DATA_AS_ROW, components);
+    mean = pca.mean;
+    vectors = pca.eigenvectors;
+    pca.project(samples, projectedSamples);
+}
+
+//Function to write a model with the samples reduced to components dimensions, 0 components writes the raw samples.
+//Training sets of LSH_MIN_SAMPLES and more get a neighbour index, so the search does not have to measure every sample.
+bool writeProjectedModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples, int components,
+                         FeatureType featureType, ThreadPool* pool)
+{
+    DigitModelContents contents;
+    contents.featureType = featureType;
+    contents.labels = labels;
+    contents.samples = samples;
+    if (components > 0) {
+        fitProjection(samples, components, contents.projectionMean, contents.projectionVectors, contents.samples);
+        std::cout << "pca: " << samples.cols << " dimensions reduced to " << contents.samples.cols << "\n";
+    }
+    if (contents.samples.rows >= LSH_MIN_SAMPLES) {
+        cv::Mat indexed;
+        contents.samples.convertTo(indexed, CV_32F);
+        indexed = indexed.clone();                      // the index is built over the rows as the model stores them
+        contents.index = LshIndex::build(indexed.ptr<float>(), indexed.rows, indexed.cols, LSH_DEFAULT_TABLES, LSH_DEFAULT_BITS, 1, pool);
+        std::cout << "index: " << LSH_DEFAULT_TABLES << " tables of " << (1 << LSH_DEFAULT_BITS) << " buckets, "
+                  << contents.index.size() << " bytes\n";
+    }
+    return writeDigitModel(modelFile, contents);
+}
+
+//Function to move the appended segments of opened model contents into its labels and samples, in one piece
+static void foldSegments(DigitModelContents& contents)
+{
+    cv::Mat labels = contents.labels;
+    cv::Mat samples = contents.samples;
+    for (size_t i = 0; i < contents.appendedSamples.size(); i++) {
+        cv::vconcat(labels, contents.appendedLabels[i], labels);
+        cv::vconcat(samples, contents.appendedSamples[i], samples);
+    }
+    contents.labels = labels;
+    contents.samples = samples.isContinuous() ? samples : samples.clone();
+    contents.appendedLabels.clear();
+    contents.appendedSamples.clear();
+}
+
+//Function to write an existing model again with a neighbour index of the given size, appended samples are folded in
+bool indexModelFile(const std::string& modelFile, int tables, int bits)
+{
+    DigitModel model;
+    DigitModelContents contents;
+    if (!openDigitModel(modelFile, model, contents)) {
+        return false;
+    }
+    foldSegments(contents);
+
+    ThreadPool pool;
+    cv::TickMeter timer;
+    timer.start();
+    contents.index = LshIndex::build(contents.samples.ptr<float>(), contents.samples.rows, contents.samples.cols, tables, bits, 1, &pool);
+    timer.stop();
+    std::cout << "index of " << contents.samples.rows << " samples built in " << timer.getTimeMilli() << " ms, "
+              << contents.index.size() << " bytes\n\n";
+    return writeDigitModel(modelFile, contents);            // written next to the mapped file and renamed over it
+}
+
+//Function to write a model again with its appended segments folded into the samples section, so the search
+//runs over one block again. A neighbour index is built again over all samples with the tables and bits it had.
+bool compactModelFile(const std::string& modelFile, ThreadPool& pool)
+{
+    DigitModel model;
+    DigitModelContents contents;
+    if (!openDigitModel(modelFile, model, contents)) {
+        return false;
+    }
+    int segments = model.segmentCount();
+    LshIndex index;
+    bool indexed = index.open(model.index(), model.indexSize());
+    foldSegments(contents);
+    if (indexed) {
+        contents.index = LshIndex::build(contents.samples.ptr<float>(), contents.samples.rows, contents.samples.cols,
+                                         index.tables(), index.bits(), 1, &pool);
+    }
+    std::cout << segments << " segments of " << modelFile << " folded into one of " << contents.samples.rows << " samples"
+              << (indexed ? ", index built again" : "") << "\n";
+    return writeDigitModel(modelFile, contents);            // written next to the mapped file and renamed over it
+}
+
+//Function to write a PCA reduced copy of an existing, unprojected model
+bool projectModelFile(const std::string& modelFile, const std::string& projectedModelFile, int components)
+{
+    DigitModel model;
+    DigitModelContents contents;
+    if (!openDigitModel(modelFile, model, contents)) {
+        return false;
+    }
+    if (!contents.projectionVectors.empty()) {
+        std::cout << "error, " << modelFile << " is already projected\n\n";
+        return false;
+    }
+    cv::Mat labels = contents.labels;
+    cv::Mat samples = contents.samples;
+    for (size_t i = 0; i < contents.appendedSamples.size(); i++) {
+        cv::vconcat(labels, contents.appendedLabels[i], labels);
+        cv::vconcat(samples, contents.appendedSamples[i], samples);
+    }
+    return writeProjectedModel(projectedModelFile, labels, samples, components, contents.featureType);
+}
+
+//Function to drop samples that are byte for byte identical to an earlier sample with the same label
+static void removeDuplicates(const cv::Mat& labels, const cv::Mat& samples, cv::Mat& keptLabels, cv::Mat& keptSamples)
+{
+    std::set<std::string> seen;
+    for (int i = 0; i < samples.rows; i++)
+    {
+        cv::Mat row = samples.row(i).clone();
+        std::string key(reinterpret_cast<const char*>(&labels.at<int>(i)), sizeof(int));
+        key.append(reinterpret_cast<const char*>(row.data), row.total() * row.elemSize());
+        if (seen.insert(key).second) {
+            keptLabels.push_back(labels.row(i));
+            keptSamples.push_back(row);
+        }
+    }
+}
+
+static const size_t CONDENSE_BATCH = 256;     // samples classified per search while condensing
+
+//Function to keep the samples the classifier needs to label every other training sample correctly (Hart's condensed
+//nearest neighbour, with the knn vote of DigitClassifier instead of a single neighbour). The set starts with one
+//sample per label; the samples that are not kept are classified CONDENSE_BATCH rows per search and the misclassified
+//ones of a batch are added before the next batch, passes repeat until a full pass adds nothing. The kept samples
+//themselves are not checked, their own vote may still go to their neighbours.
+static void condenseSamples(const cv::Mat& labels, const cv::Mat& samples, cv::Mat& keptLabels, cv::Mat& keptSamples)
+{
+    std::vector<bool> kept(size_t(samples.rows), false);
+    std::set<int> seenLabels;
+    for (int i = 0; i < samples.rows; i++) {
+        if (seenLabels.insert(labels.at<int>(i)).second) {
+            kept[size_t(i)] = true;
+            keptLabels.push_back(labels.row(i));
+            keptSamples.push_back(samples.row(i));
+        }
+    }
+
+    bool added = true;
+    while (added)
+    {
+        added = false;
+        std::vector<int> rows;
+        for (int i = 0; i < samples.rows; i++) {
+            if (!kept[size_t(i)]) rows.push_back(i);
+        }
+        for (size_t first = 0; first < rows.size(); first += CONDENSE_BATCH)
+        {
+            size_t last = std::min(rows.size(), first + CONDENSE_BATCH);
+            cv::Mat batch;
+            for (size_t r = first; r < last; r++) {
+                batch.push_back(samples.row(rows[r]));
+            }
+
+            //the classifier only points at the kept rows, building it is cheap next to the search
+            DigitModelContents contents;
+            contents.labels = keptLabels;
+            contents.samples = keptSamples;
+            DigitClassifier classifier;
+            classifier.create(contents);
+            std::vector<int> intChars;
+            classifier.classifyBatch(batch, intChars);
+
+            for (size_t r = first; r < last; r++) {
+                int i = rows[r];
+                if (intChars[r - first] == labels.at<int>(i)) {
+                    continue;
+                }
+                kept[size_t(i)] = true;
+                keptLabels.push_back(labels.row(i));
+                keptSamples.push_back(samples.row(i));
+                added = true;
+            }
+        }
+    }
+}
+
+//Function to shrink a training set to the samples of the given stage
+void reduceTrainingSet(const cv::Mat& labels, const cv::Mat& samples, ReductionStage stage, cv::Mat& keptLabels, cv::Mat& keptSamples)
+{
+    keptLabels.release();
+    keptSamples.release();
+    if (stage == REDUCE_NONE) {
+        keptLabels = labels.clone();
+        keptSamples = samples.clone();
+        return;
+    }
+
+    cv::Mat uniqueLabels, uniqueSamples;
+    removeDuplicates(labels, samples, uniqueLabels, uniqueSamples);
+    if (stage == REDUCE_DUPLICATES) {
+        keptLabels = uniqueLabels;
+        keptSamples = uniqueSamples;
+        return;
+    }
+    condenseSamples(uniqueLabels, uniqueSamples, keptLabels, keptSamples);
+}
+
+//Function to print size, query time and validation accuracy of every reduction stage and return the smallest
+//stage whose accuracy is at most tolerance percentage points below the accuracy of the full training set
+ReductionStage chooseReduction(const cv::Mat& trainLabels, const cv::Mat& trainSamples,
+                               const cv::Mat& validationLabels, const cv::Mat& validationSamples, double tolerance)
+{
+    const ReductionStage stages[] = {REDUCE_NONE, REDUCE_DUPLICATES, REDUCE_CONDENSED};
+    const char* const stageNames[] = {"full", "without duplicates", "condensed"};
+    ReductionStage chosen = REDUCE_NONE;
+    double fullAccuracy = 0;
+
+    for (int s = 0; s < 3; s++)
+    {
+        cv::Mat keptLabels, keptSamples;
+        cv::TickMeter reduceTimer;
+        reduceTimer.start();
+        reduceTrainingSet(trainLabels, trainSamples, stages[s], keptLabels, keptSamples);
+        reduceTimer.stop();
+
+        DigitModelContents contents;
+        contents.labels = keptLabels;
+        contents.samples = keptSamples;
+        DigitClassifier classifier;
+        classifier.create(contents);
+
+        std::vector<int> intChars;
+        cv::TickMeter timer;
+        timer.start();
+        classifier.classifyBatch(validationSamples, intChars);
+        timer.stop();
+
+        double accuracy = labelAccuracy(intChars, validationLabels);
+        if (s == 0) fullAccuracy = accuracy;
+        if (accuracy >= fullAccuracy - tolerance) chosen = stages[s];       // later stages are smaller
+
+        std::cout << stageNames[s] << ": " << keptSamples.rows << " samples ("
+                  << 100.0 * keptSamples.rows / trainSamples.rows << " %), "
+                  << timer.getTimeMicro() / validationSamples.rows << " us per query, accuracy " << accuracy << " %, "
+                  << reduceTimer.getTimeMilli() << " ms to reduce\n";
+    }
+    std::cout << "within " << tolerance << " % of the full set: " << stageNames[chosen] << "\n\n";
+    return chosen;
+}
+
+//Function to train the digit model from a labelled digit tree without any key presses: the files are listed,
+//decoded, augmented and turned into features on every thread of the pool and the model is written in one go.
+//Prints the time of every stage.
+bool trainDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, FeatureType featureType,
+                   int pcaComponents, ThreadPool& pool, const AugmentOptions& augment)
+{
+    cv::TickMeter listTimer, decodeTimer, featureTimer, writeTimer;
+
+    //a pack file is mapped instead of listed and decoded
+    bool packed = isDigitPack(dataBaseDirectory);
+    listTimer.start();
+    std::vector<std::string> files;
+    std::vector<int> fileLabels;
+    bool listed = packed || listDigitFiles(dataBaseDirectory, files, fileLabels);
+    listTimer.stop();
+    if (!listed) {
+        return false;
+    }
+
+    decodeTimer.start();
+    cv::Mat labels;
+    std::vector<cv::Mat> images;
+    if (packed) {
+        if (!loadDigitPack(dataBaseDirectory, labels, images)) {
+            return false;           // loadDigitPack said why
+        }
+    }
+    else {
+        decodeDigitImages(files, fileLabels, labels, images, &pool);
+    }
+    decodeTimer.stop();
+    if (images.empty()) {
+        std::cout << "error, none of the " << files.size() << " files in " << dataBaseDirectory << " could be decoded\n\n";
+        return false;
+    }
+    if (packed) {
+        files.resize(images.size());            // for the counts below, a pack has one image per sample
+    }
+
+    featureTimer.start();
+    cv::Mat sampleLabels;
+    cv::Mat samples = augmentedSamples(images, labels, featureType, augment, sampleLabels, &pool);
+    featureTimer.stop();
+
+    writeTimer.start();
+    bool written = writeProjectedModel(modelFile, sampleLabels, samples, pcaComponents, featureType, &pool);
+    writeTimer.stop();
+
+    double totalMs = listTimer.getTimeMilli() + decodeTimer.getTimeMilli() + featureTimer.getTimeMilli() + writeTimer.getTimeMilli();
+    std::cout << images.size() << " of " << files.size() << " images, " << samples.rows << " samples, "
+              << featureTypeName(featureType) << " features, " << pool.threadCount() << " threads\n";
+    std::cout << "list files:      " << listTimer.getTimeMilli() << " ms\n";
+    std::cout << "decode images:   " << decodeTimer.getTimeMilli() << " ms\n";
+    std::cout << (augment.variants > 0 ? "augment, features: " : "features:        ") << featureTimer.getTimeMilli() << " ms\n";
+    std::cout << (pcaComponents > 0 ? "pca and write:   " : "write model:     ") << writeTimer.getTimeMilli() << " ms\n";
+    std::cout << "total:           " << totalMs << " ms, " << 1000.0 * samples.rows / totalMs << " samples per second\n\n";
+    return written;
+}
+
+//Function to add the images of a labelled digit tree to an existing model. Only the new images are decoded and
+//only their samples are written, so a few hundred corrections cost the same for a small and a 100k sample model.
+bool appendDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, ThreadPool& pool)
+{
+    FeatureType featureType;
+    {
+        DigitModel model;               // only mapped to see which features the model holds
+        if (!model.open(modelFile)) {
+            return false;
+        }
+        featureType = model.featureType();
+    }
+
+    cv::TickMeter decodeTimer, appendTimer;
+    decodeTimer.start();
+    cv::Mat labels;
+    std::vector<cv::Mat> images;
+    bool loaded = loadDigitImages(dataBaseDirectory, labels, images, &pool);
+    cv::Mat samples = digitImagesToSamples(images, featureType, &pool);
+    decodeTimer.stop();
+    if (!loaded || samples.rows == 0) {
+        std::cout << "error, no images to append in " << dataBaseDirectory << "\n\n";
+        return false;
+    }
+
+    appendTimer.start();
+    bool appended = appendDigitModel(modelFile, labels, samples);
+    appendTimer.stop();
+
+    //every segment is a block of its own for the search, past the limit they are folded together in one rewrite
+    int segments = 0;
+    {
+        DigitModel model;
+        if (appended && model.open(modelFile)) {
+            segments = model.segmentCount() - 1;
+        }
+    }
+    if (segments > DIGIT_MODEL_MAX_SEGMENTS) {
+        appended = compactModelFile(modelFile, pool);
+    }
+
+    std::cout << samples.rows << " " << featureTypeName(featureType) << " samples appended to " << modelFile << "\n";
+    std::cout << "decode, features: " << decodeTimer.getTimeMilli() << " ms\n";
+    std::cout << "append:           " << appendTimer.getTimeMilli() << " ms\n\n";
+    return appended;
+}
+
+//Function to pack a labelled digit tree into one pack file for the other tools, and time reading the pixel
+//features from the tree against reading them from the pack
+bool packDataBase(const std::string& dataBaseDirectory, const std::string& packFile, ThreadPool& pool)
+{
+    cv::TickMeter decodeTimer, packTimer, mappedTimer;
+    decodeTimer.start();
+    cv::Mat labels;
+    std::vector<cv::Mat> images;
+    bool loaded = loadDigitImages(dataBaseDirectory, labels, images, &pool);
+    cv::Mat samples = digitImagesToSamples(images, FEATURE_PIXELS, &pool);
+    decodeTimer.stop();
+    if (!loaded) {
+        return false;
+    }
+
+    packTimer.start();
+    bool packed = writeDigitPack(packFile, labels, images);
+    packTimer.stop();
+    if (!packed) {
+        return false;
+    }
+
+    mappedTimer.start();
+    cv::Mat packLabels, packSamples;
+    bool mapped = loadDigitPackSamples(packFile, packLabels, packSamples, FEATURE_PIXELS, &pool);
+    mappedTimer.stop();
+
+    std::cout << images.size() << " images of " << dataBaseDirectory << " packed into " << packFile << "\n";
+    std::cout << "decode, features: " << decodeTimer.getTimeMilli() << " ms\n";
+    std::cout << "write pack:       " << packTimer.getTimeMilli() << " ms\n";
+    std::cout << "pack, features:   " << mappedTimer.getTimeMilli() << " ms"
+              << (mapped && cv::norm(samples, packSamples, cv::NORM_INF) == 0.0 ? ", same samples" : ", SAMPLES DIFFER") << "\n\n";
+    return mapped;
+}
+
+//Function to build a model from a labelled digit tree with the smallest training set that stays within tolerance.
+//The stage is chosen on a train/test split, then applied to all samples so the model still learns from every image.
+bool condenseDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, double tolerance)
+{
+    cv::Mat labels, samples;
+    if (!loadDigitDataBase(dataBaseDirectory, labels, samples)) {
+        return false;
+    }
+    cv::Mat trainLabels, trainSamples, testLabels, testSamples;
+    splitTrainTest(labels, samples, 4, trainLabels, trainSamples, testLabels, testSamples);
+    ReductionStage stage = chooseReduction(trainLabels, trainSamples, testLabels, testSamples, tolerance);
+
+    cv::Mat keptLabels, keptSamples;
+    reduceTrainingSet(labels, samples, stage, keptLabels, keptSamples);
+    std::cout << "writing " << keptSamples.rows << " of " << samples.rows << " samples to " << modelFile << "\n";
+    return writeDigitModel(modelFile, keptLabels, keptSamples);
+}
+
+void trainingNumbers(int pcaComponents, FeatureType featureType) {
 
     cv::Mat imgTrainingNumbers;         // input image
     cv::Mat imgGrayscale;               //
@@ -97,42 +508,21 @@ void trainingNumbers() {
 
                 matClassificationInts.push_back(intChar);       // append classification char to integer list of chars
 
-                cv::Mat matImageFloat;                          // now add the training image (some conversion is necessary first) . . .
-                matROIResized.convertTo(matImageFloat, CV_32FC1);       // convert Mat to float
-
-                cv::Mat matImageFlattenedFloat = matImageFloat.reshape(1, 1);       // flatten
+                cv::Mat matImageFeatures = extractFeatures(matROI, featureType);      // now add the training image as the selected features
 
-                matTrainingImagesAsFlattenedFloats.push_back(matImageFlattenedFloat);       // add to Mat as though it was a vector, this is necessary due to the
-                // data types that KNearest.train accepts
+                matTrainingImagesAsFlattenedFloats.push_back(matImageFeatures);     // add to Mat as though it was a vector, one row per sample
             }   // end if
         }   // end if
     }   // end for
 
     std::cout << "training complete\n\n";
 
-    // ========================== save classifications to file =============================
-
-    cv::FileStorage fsClassifications("classifications.xml", cv::FileStorage::WRITE);           // open the classifications file
+    // ========================== save model to file ======================================
 
-    if (fsClassifications.isOpened() == false) {                                                        // if the file was not opened successfully
-        std::cout << "error, unable to open training classifications file, exiting program\n\n";        // show error message
-        return;                                                                                      // and exit program
+    if (!writeProjectedModel("digits.model", matClassificationInts, matTrainingImagesAsFlattenedFloats, pcaComponents, featureType)) {     // labels, samples, optional pca and header in one binary file
+        std::cout << "error, unable to write model file, exiting program\n\n";                          // show error message
+        return;                                                                                         // and exit program
     }
 
-    fsClassifications << "classifications" << matClassificationInts;        // write classifications into classifications section of classifications file
-    fsClassifications.release();                                            // close the classifications file
-
-    //============================ save training images to file ========================
-
-    cv::FileStorage fsTrainingImages("images.xml", cv::FileStorage::WRITE);         // open the training images file
-
-    if (fsTrainingImages.isOpened() == false) {                                                 // if the file was not opened successfully
-        std::cout << "error, unable to open training images file, exiting program\n\n";         // show error message
-        return;                                                                              // and exit program
-    }
-
-    fsTrainingImages << "images" << matTrainingImagesAsFlattenedFloats;         // write training images into images section of images file
-    fsTrainingImages.release();                                              // close the training images file
-
     return;
 }
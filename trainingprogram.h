@@ -5,6 +5,32 @@
 #include "opencv2/highgui.hpp"
 #include "opencv2/imgcodecs.hpp"
 
-void trainingNumbers();
+#include "digitfeatures.h"
+#include "threadpool.h"
+#include "digitaugment.h"
+#include "lshindex.h"
+#include <string>
+
+enum ReductionStage {
+    REDUCE_NONE,                // every training sample
+    REDUCE_DUPLICATES,          // identical samples with the same label stored once
+    REDUCE_CONDENSED            // no duplicates, and only the samples the knn vote needs to label all the others correctly
+};
+
+void trainingNumbers(int pcaComponents = 0, FeatureType featureType = FEATURE_PIXELS);
+void fitProjection(const cv::Mat& samples, int components, cv::Mat& mean, cv::Mat& vectors, cv::Mat& projectedSamples);
+bool writeProjectedModel(const std::string& modelFile, const cv::Mat& labels, const cv::Mat& samples, int components,
+                         FeatureType featureType = FEATURE_PIXELS, ThreadPool* pool = nullptr);
+bool indexModelFile(const std::string& modelFile, int tables, int bits);
+bool compactModelFile(const std::string& modelFile, ThreadPool& pool);
+bool projectModelFile(const std::string& modelFile, const std::string& projectedModelFile, int components);
+void reduceTrainingSet(const cv::Mat& labels, const cv::Mat& samples, ReductionStage stage, cv::Mat& keptLabels, cv::Mat& keptSamples);
+ReductionStage chooseReduction(const cv::Mat& trainLabels, const cv::Mat& trainSamples,
+                               const cv::Mat& validationLabels, const cv::Mat& validationSamples, double tolerance);
+bool trainDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, FeatureType featureType,
+                   int pcaComponents, ThreadPool& pool, const AugmentOptions& augment = AugmentOptions());
+bool appendDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, ThreadPool& pool);
+bool packDataBase(const std::string& dataBaseDirectory, const std::string& packFile, ThreadPool& pool);
+bool condenseDataBase(const std::string& dataBaseDirectory, const std::string& modelFile, double tolerance);
 
 #endif // TRAININGPROGRAM_H